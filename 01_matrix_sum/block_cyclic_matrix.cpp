@@ -0,0 +1,133 @@
+// Copyright 2020 Vlasov Maksim
+#include <mpi.h>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "block_cyclic_matrix.h"
+
+// Global indices of the block-cyclic slice that belongs to the process with the given grid coordinate
+static std::vector<int> cyclicIndices(int size, int block_size, int procs, int proc) {
+    std::vector<int> indices;
+    for (int block_begin = proc * block_size; block_begin < size; block_begin += procs * block_size)
+        for (int i = block_begin; i < size && i < block_begin + block_size; i++)
+            indices.push_back(i);
+    return indices;
+}
+
+BlockCyclicMatrix::BlockCyclicMatrix(const std::vector<int> &matrix, int rows, int cols, int block_size,
+                                     MPI_Comm comm)
+    : rows_(rows), cols_(cols), block_size_(block_size) {
+    if (rows < 0 || cols < 0)
+        throw std::runtime_error("Matrix dimensions must not be negative");
+    if (block_size <= 0)
+        throw std::runtime_error("Block size must be positive");
+    int process_count, process_rank;
+    MPI_Comm_size(comm, &process_count);
+    MPI_Comm_rank(comm, &process_rank);
+
+    grid_dims_[0] = grid_dims_[1] = 0;
+    MPI_Dims_create(process_count, 2, grid_dims_);
+    int periods[2] = { 0, 0 };
+    MPI_Cart_create(comm, 2, grid_dims_, periods, 0, &grid_comm_);
+    MPI_Cart_coords(grid_comm_, process_rank, 2, grid_coords_);
+    int row_remain[2] = { 0, 1 };
+    int col_remain[2] = { 1, 0 };
+    MPI_Cart_sub(grid_comm_, row_remain, &row_comm_);
+    MPI_Cart_sub(grid_comm_, col_remain, &col_comm_);
+
+    local_rows_ = cyclicIndices(rows_, block_size_, grid_dims_[0], grid_coords_[0]);
+    local_cols_ = cyclicIndices(cols_, block_size_, grid_dims_[1], grid_coords_[1]);
+    local_.resize(local_rows_.size() * local_cols_.size());
+
+    // The root packs every local matrix contiguously, so one MPI_Scatterv is enough
+    std::vector<int> send_buffer, counts, displs;
+    if (process_rank == 0) {
+        send_buffer.reserve(static_cast<size_t>(rows_) * cols_);
+        counts.resize(process_count);
+        displs.resize(process_count);
+        for (int process_num = 0; process_num < process_count; process_num++) {
+            int coords[2];
+            MPI_Cart_coords(grid_comm_, process_num, 2, coords);
+            auto part_rows = cyclicIndices(rows_, block_size_, grid_dims_[0], coords[0]);
+            auto part_cols = cyclicIndices(cols_, block_size_, grid_dims_[1], coords[1]);
+            displs[process_num] = static_cast<int>(send_buffer.size());
+            for (int row : part_rows)
+                for (int col : part_cols)
+                    send_buffer.push_back(matrix[static_cast<size_t>(row) * cols_ + col]);
+            counts[process_num] = static_cast<int>(send_buffer.size()) - displs[process_num];
+        }
+    }
+    MPI_Scatterv(send_buffer.data(), counts.data(), displs.data(), MPI_INT, local_.data(),
+                 static_cast<int>(local_.size()), MPI_INT, 0, grid_comm_);
+}
+
+BlockCyclicMatrix::~BlockCyclicMatrix() {
+    MPI_Comm_free(&col_comm_);
+    MPI_Comm_free(&row_comm_);
+    MPI_Comm_free(&grid_comm_);
+}
+
+// Reduces partial sums along one grid axis and gathers the totals on the process (0, 0).
+// axis = 0 stands for row sums, axis = 1 stands for column sums.
+std::vector<int64_t> BlockCyclicMatrix::gatherAxis(const std::vector<int64_t> &part_sums, int axis) const {
+    MPI_Comm reduce_comm = axis == 0 ? row_comm_ : col_comm_;
+    MPI_Comm gather_comm = axis == 0 ? col_comm_ : row_comm_;
+    int size = axis == 0 ? rows_ : cols_;
+    std::vector<int64_t> sums(part_sums.size());
+    MPI_Reduce(part_sums.data(), sums.data(), static_cast<int>(part_sums.size()), MPI_INT64_T, MPI_SUM, 0,
+               reduce_comm);
+    if (grid_coords_[1 - axis] != 0)
+        return std::vector<int64_t>();
+
+    int procs = grid_dims_[axis];
+    std::vector<int> counts(procs), displs(procs);
+    for (int proc = 0, displ = 0; proc < procs; proc++) {
+        counts[proc] = static_cast<int>(cyclicIndices(size, block_size_, procs, proc).size());
+        displs[proc] = displ;
+        displ += counts[proc];
+    }
+    std::vector<int64_t> gathered(grid_coords_[axis] == 0 ? size : 0);
+    MPI_Gatherv(sums.data(), static_cast<int>(sums.size()), MPI_INT64_T, gathered.data(), counts.data(),
+                displs.data(), MPI_INT64_T, 0, gather_comm);
+    if (grid_coords_[axis] != 0)
+        return std::vector<int64_t>();
+    std::vector<int64_t> result(size);
+    for (int proc = 0; proc < procs; proc++) {
+        auto indices = cyclicIndices(size, block_size_, procs, proc);
+        for (size_t i = 0; i < indices.size(); i++)
+            result[indices[i]] = gathered[displs[proc] + i];
+    }
+    return result;
+}
+
+std::vector<int64_t> BlockCyclicMatrix::rowSums() const {
+    std::vector<int64_t> part_sums(local_rows_.size(), 0);
+    for (size_t i = 0; i < local_rows_.size(); i++)
+        for (size_t j = 0; j < local_cols_.size(); j++)
+            part_sums[i] += local_[i * local_cols_.size() + j];
+    return gatherAxis(part_sums, 0);
+}
+
+std::vector<int64_t> BlockCyclicMatrix::colSums() const {
+    std::vector<int64_t> part_sums(local_cols_.size(), 0);
+    for (size_t i = 0; i < local_rows_.size(); i++)
+        for (size_t j = 0; j < local_cols_.size(); j++)
+            part_sums[j] += local_[i * local_cols_.size() + j];
+    return gatherAxis(part_sums, 1);
+}
+
+int64_t BlockCyclicMatrix::blockSum(int row_begin, int col_begin, int row_end, int col_end) const {
+    if (row_begin < 0 || col_begin < 0 || row_end > rows_ || col_end > cols_ || row_begin > row_end ||
+        col_begin > col_end)
+        throw std::runtime_error("Invalid block");
+    int64_t part_sum = 0, sum = 0;
+    for (size_t i = 0; i < local_rows_.size(); i++) {
+        if (local_rows_[i] < row_begin || local_rows_[i] >= row_end)
+            continue;
+        for (size_t j = 0; j < local_cols_.size(); j++)
+            if (local_cols_[j] >= col_begin && local_cols_[j] < col_end)
+                part_sum += local_[i * local_cols_.size() + j];
+    }
+    MPI_Reduce(&part_sum, &sum, 1, MPI_INT64_T, MPI_SUM, 0, grid_comm_);
+    return sum;
+}
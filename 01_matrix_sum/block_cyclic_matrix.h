@@ -0,0 +1,48 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Row-major rows x cols matrix distributed over a 2D process grid (MPI_Cart_create).
+ *
+ * The matrix is split into block_size x block_size blocks, block (i, j) belongs
+ * to the process with grid coordinates (i % grid rows, j % grid cols). Row sums
+ * are reduced inside grid row communicators and column sums inside grid column
+ * communicators, so only vectors of rows (cols) partial sums travel between
+ * processes and the matrix itself is never brought back to a single process.
+ *
+ * The matrix is read on the process 0 of comm only, results are returned there too.
+ */
+class BlockCyclicMatrix {
+public:
+    BlockCyclicMatrix(const std::vector<int> &matrix, int rows, int cols, int block_size = 16,
+                      MPI_Comm comm = MPI_COMM_WORLD);
+    BlockCyclicMatrix(const BlockCyclicMatrix &) = delete;
+    BlockCyclicMatrix &operator=(const BlockCyclicMatrix &) = delete;
+    ~BlockCyclicMatrix();
+
+    std::vector<int64_t> rowSums() const;
+    std::vector<int64_t> colSums() const;
+    // Sum of the elements in rows [row_begin, row_end) and columns [col_begin, col_end)
+    int64_t blockSum(int row_begin, int col_begin, int row_end, int col_end) const;
+
+    int gridRows() const {
+        return grid_dims_[0];
+    }
+    int gridCols() const {
+        return grid_dims_[1];
+    }
+
+private:
+    int rows_, cols_, block_size_;
+    int grid_dims_[2], grid_coords_[2];
+    MPI_Comm grid_comm_, row_comm_, col_comm_;
+    // Global indices of the rows and columns stored on the current process
+    std::vector<int> local_rows_, local_cols_;
+    std::vector<int> local_;
+
+    std::vector<int64_t> gatherAxis(const std::vector<int64_t> &part_sums, int axis) const;
+};
@@ -0,0 +1,71 @@
+// Copyright 2020 Vlasov Maksim
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "counter_random.h"
+
+namespace CounterRandom {
+    // Number of Philox blocks generated at once. The rounds are computed for the
+    // whole batch in structure-of-arrays layout, so the compiler can map the lanes
+    // of the batch onto SIMD registers.
+    const int kBatchBlocks = 16;
+
+    static void philoxBatch(uint64_t first_block, uint64_t seed, uint32_t words[kBatchBlocks * 4]) {
+        uint32_t counter[4][kBatchBlocks];
+        for (int lane = 0; lane < kBatchBlocks; lane++) {
+            uint64_t block = first_block + lane;
+            counter[0][lane] = static_cast<uint32_t>(block);
+            counter[1][lane] = static_cast<uint32_t>(block >> 32);
+            counter[2][lane] = 0;
+            counter[3][lane] = 0;
+        }
+        uint32_t key[2] = { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) };
+        for (int round = 0; round < 10; round++) {
+            for (int lane = 0; lane < kBatchBlocks; lane++) {
+                uint64_t product_0 = static_cast<uint64_t>(0xD2511F53u) * counter[0][lane];
+                uint64_t product_1 = static_cast<uint64_t>(0xCD9E8D57u) * counter[2][lane];
+                uint32_t result_0 = static_cast<uint32_t>(product_1 >> 32) ^ counter[1][lane] ^ key[0];
+                uint32_t result_2 = static_cast<uint32_t>(product_0 >> 32) ^ counter[3][lane] ^ key[1];
+                counter[0][lane] = result_0;
+                counter[1][lane] = static_cast<uint32_t>(product_1);
+                counter[2][lane] = result_2;
+                counter[3][lane] = static_cast<uint32_t>(product_0);
+            }
+            key[0] += 0x9E3779B9u;
+            key[1] += 0xBB67AE85u;
+        }
+        for (int lane = 0; lane < kBatchBlocks; lane++)
+            for (int i = 0; i < 4; i++)
+                words[lane * 4 + i] = counter[i][lane];
+    }
+
+    void fill(uint64_t seed, int64_t begin, int count, uint32_t bound, int* out) {
+        const int64_t batch_size = kBatchBlocks * 4;
+        uint32_t words[kBatchBlocks * 4];
+        int64_t end = begin + count;
+        for (int64_t batch_begin = begin - begin % batch_size; batch_begin < end; batch_begin += batch_size) {
+            philoxBatch(static_cast<uint64_t>(batch_begin / 4), seed, words);
+            int64_t first = std::max(begin, batch_begin);
+            int64_t last = std::min(end, batch_begin + batch_size);
+            for (int64_t i = first; i < last; i++) {
+                // Multiply-shift scaling avoids the division of the modulo operation
+                uint64_t scaled = (static_cast<uint64_t>(words[i - batch_begin]) * bound) >> 32;
+                out[i - begin] = static_cast<int>(scaled);
+            }
+        }
+    }
+
+    void fillParallel(uint64_t seed, int64_t begin, int count, uint32_t bound, int* out, int num_threads) {
+        num_threads = std::max(1, std::min(num_threads, count));
+        int delta = count / num_threads;
+        int remain = count % num_threads;
+        std::vector<std::thread> threads;
+        threads.reserve(num_threads - 1);
+        for (int t_id = 1, offset = delta + remain; t_id < num_threads; t_id++, offset += delta)
+            threads.emplace_back(fill, seed, begin + offset, delta, bound, out + offset);
+        fill(seed, begin, delta + remain, bound, out);
+        for (auto& thread : threads)
+            thread.join();
+    }
+}  // namespace CounterRandom
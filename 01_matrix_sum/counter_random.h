@@ -0,0 +1,36 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Counter-based random number generation (Philox4x32-10).
+ *
+ * The value of the element with global index i depends only on the seed and
+ * on i, so any part of a random vector may be generated independently by any
+ * process or thread, and the data are the same for any number of processes.
+ */
+namespace CounterRandom {
+    // Transforms a 128-bit counter into four random 32-bit words
+    inline void philox4x32(uint32_t counter[4], uint64_t seed) {
+        uint32_t key[2] = { static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) };
+        for (int round = 0; round < 10; round++) {
+            uint64_t product_0 = static_cast<uint64_t>(0xD2511F53u) * counter[0];
+            uint64_t product_1 = static_cast<uint64_t>(0xCD9E8D57u) * counter[2];
+            uint32_t result[4] = { static_cast<uint32_t>(product_1 >> 32) ^ counter[1] ^ key[0],
+                                   static_cast<uint32_t>(product_1),
+                                   static_cast<uint32_t>(product_0 >> 32) ^ counter[3] ^ key[1],
+                                   static_cast<uint32_t>(product_0) };
+            for (int i = 0; i < 4; i++)
+                counter[i] = result[i];
+            key[0] += 0x9E3779B9u;
+            key[1] += 0xBB67AE85u;
+        }
+    }
+
+    // Writes the elements [begin, begin + count) of the stream defined by seed, scaled to [0, bound)
+    void fill(uint64_t seed, int64_t begin, int count, uint32_t bound, int* out);
+
+    // Same as fill, but the range is split between num_threads threads
+    void fillParallel(uint64_t seed, int64_t begin, int count, uint32_t bound, int* out, int num_threads);
+}  // namespace CounterRandom
@@ -0,0 +1,124 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "matrix_sum.h"
+#include "mpi_datatype.h"
+#include "sum_kernels.h"
+
+/**
+ * Vector which is scattered from the process 0 of comm once and then stays
+ * resident: every process keeps its partition (see calculatePartition) between
+ * calls. Reductions cost one small MPI_Allreduce each and return the result on
+ * all processes, element-wise updates are done in place without communication.
+ */
+template <typename T>
+class DistributedVector {
+public:
+    using Accumulator =
+        typename std::conditional<std::is_integral<T>::value, SumKernels::Int64, SumKernels::Compensated>::type;
+    using sum_type = typename Accumulator::value_type;
+
+    DistributedVector(const std::vector<T> &vector, int elements_count, MPI_Comm comm = MPI_COMM_WORLD)
+        : comm_(comm), size_(elements_count) {
+        int process_count, process_rank;
+        MPI_Comm_size(comm_, &process_count);
+        MPI_Comm_rank(comm_, &process_rank);
+        std::vector<int> counts, displs;
+        calculatePartition(elements_count, process_count, &counts, &displs);
+        offset_ = displs[process_rank];
+        local_.resize(counts[process_rank]);
+        MPI_Scatterv(vector.data(), counts.data(), displs.data(), MpiDatatype<T>::get(), local_.data(),
+                     counts[process_rank], MpiDatatype<T>::get(), 0, comm_);
+    }
+
+    int size() const {
+        return size_;
+    }
+    // Global index of the first element stored on the current process
+    int localOffset() const {
+        return offset_;
+    }
+    const std::vector<T> &local() const {
+        return local_;
+    }
+
+    sum_type sum() const {
+        sum_type part_sum = SumKernels::sum<Accumulator>(local_.data(), local_.size());
+        sum_type sum = 0;
+        MPI_Allreduce(&part_sum, &sum, 1, Accumulator::datatype(), MPI_SUM, comm_);
+        return sum;
+    }
+
+    T min() const {
+        checkNotEmpty();
+        T part_min = std::numeric_limits<T>::max();
+        for (const T &elem : local_)
+            if (elem < part_min)
+                part_min = elem;
+        T min;
+        MPI_Allreduce(&part_min, &min, 1, MpiDatatype<T>::get(), MPI_MIN, comm_);
+        return min;
+    }
+
+    T max() const {
+        checkNotEmpty();
+        T part_max = std::numeric_limits<T>::lowest();
+        for (const T &elem : local_)
+            if (part_max < elem)
+                part_max = elem;
+        T max;
+        MPI_Allreduce(&part_max, &max, 1, MpiDatatype<T>::get(), MPI_MAX, comm_);
+        return max;
+    }
+
+    double mean() const {
+        checkNotEmpty();
+        return static_cast<double>(sum()) / size_;
+    }
+
+    template <typename Predicate>
+    int64_t countIf(Predicate pred) const {
+        int64_t part_count = 0, count = 0;
+        for (const T &elem : local_)
+            if (pred(elem))
+                part_count++;
+        MPI_Allreduce(&part_count, &count, 1, MPI_INT64_T, MPI_SUM, comm_);
+        return count;
+    }
+
+    // Replaces every element x with func(x), no communication is involved
+    template <typename Function>
+    void transform(Function func) {
+        for (T &elem : local_)
+            elem = func(elem);
+    }
+
+    // Collects the whole vector on the process 0 of comm
+    std::vector<T> gather() const {
+        int process_count, process_rank;
+        MPI_Comm_size(comm_, &process_count);
+        MPI_Comm_rank(comm_, &process_rank);
+        std::vector<int> counts, displs;
+        calculatePartition(size_, process_count, &counts, &displs);
+        std::vector<T> result(process_rank == 0 ? size_ : 0);
+        MPI_Gatherv(local_.data(), static_cast<int>(local_.size()), MpiDatatype<T>::get(), result.data(),
+                    counts.data(), displs.data(), MpiDatatype<T>::get(), 0, comm_);
+        return result;
+    }
+
+private:
+    MPI_Comm comm_;
+    int size_, offset_;
+    std::vector<T> local_;
+
+    void checkNotEmpty() const {
+        if (size_ == 0)
+            throw std::runtime_error("Vector is empty");
+    }
+};
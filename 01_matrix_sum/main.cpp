@@ -2,8 +2,21 @@
 #include <mpi.h>
 #include <gtest-mpi-listener.hpp>
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
 #include <vector>
+#include "block_cyclic_matrix.h"
+#include "counter_random.h"
+#include "distributed_vector.h"
 #include "matrix_sum.h"
+#include "prepared_sum.h"
+#include "reduction.h"
+#include "sum_kernels.h"
 
 TEST(Parallel_Matrix_Sum_MPI, Size_0x0) {
     int process_rank;
@@ -14,9 +27,9 @@ TEST(Parallel_Matrix_Sum_MPI, Size_0x0) {
     std::vector<int> matrix;
     if (process_rank == 0)
         matrix = createRandomVector(elements_count);
-    int sum = calculateSumParallel(matrix, elements_count);
+    int64_t sum = calculateSumParallel(matrix, elements_count);
     if (process_rank == 0) {
-        int control_sum = calculateSumSequental(matrix);
+        int64_t control_sum = calculateSumSequental(matrix);
         ASSERT_EQ(control_sum, sum);
     }
 }
@@ -30,9 +43,9 @@ TEST(Parallel_Matrix_Sum_MPI, Size_1x1) {
     std::vector<int> matrix;
     if (process_rank == 0)
         matrix = createRandomVector(elements_count);
-    int sum = calculateSumParallel(matrix, elements_count);
+    int64_t sum = calculateSumParallel(matrix, elements_count);
     if (process_rank == 0) {
-        int control_sum = calculateSumSequental(matrix);
+        int64_t control_sum = calculateSumSequental(matrix);
         ASSERT_EQ(control_sum, sum);
     }
 }
@@ -46,9 +59,9 @@ TEST(Parallel_Matrix_Sum_MPI, Size_100x1) {
     std::vector<int> matrix;
     if (process_rank == 0)
         matrix = createRandomVector(elements_count);
-    int sum = calculateSumParallel(matrix, elements_count);
+    int64_t sum = calculateSumParallel(matrix, elements_count);
     if (process_rank == 0) {
-        int control_sum = calculateSumSequental(matrix);
+        int64_t control_sum = calculateSumSequental(matrix);
         ASSERT_EQ(control_sum, sum);
     }
 }
@@ -62,9 +75,9 @@ TEST(Parallel_Matrix_Sum_MPI, Size_100x200) {
     std::vector<int> matrix;
     if (process_rank == 0)
         matrix = createRandomVector(elements_count);
-    int sum = calculateSumParallel(matrix, elements_count);
+    int64_t sum = calculateSumParallel(matrix, elements_count);
     if (process_rank == 0) {
-        int control_sum = calculateSumSequental(matrix);
+        int64_t control_sum = calculateSumSequental(matrix);
         ASSERT_EQ(control_sum, sum);
     }
 }
@@ -78,13 +91,702 @@ TEST(Parallel_Matrix_Sum_MPI, Size_51x2) {
     std::vector<int> matrix;
     if (process_rank == 0)
         matrix = createRandomVector(elements_count);
-    int sum = calculateSumParallel(matrix, elements_count);
+    int64_t sum = calculateSumParallel(matrix, elements_count);
     if (process_rank == 0) {
-        int control_sum = calculateSumSequental(matrix);
+        int64_t control_sum = calculateSumSequental(matrix);
         ASSERT_EQ(control_sum, sum);
     }
 }
 
+TEST(Parallel_Matrix_Sum_MPI, Size_1000x1000_No_Overflow) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 1000;
+    int cols = 1000;
+    int elements_count = rows * cols;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = std::vector<int>(elements_count, INT_MAX);
+    int64_t sum = calculateSumParallel(matrix, elements_count);
+    if (process_rank == 0) {
+        ASSERT_EQ(static_cast<int64_t>(INT_MAX) * elements_count, sum);
+        ASSERT_EQ(calculateSumSequental(matrix), sum);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Hybrid_Size_100x200) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 100;
+    int cols = 200;
+    int elements_count = rows * cols;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    for (int num_threads = 1; num_threads <= 4; num_threads++) {
+        int64_t sum = calculateSumHybrid(matrix, elements_count, num_threads);
+        if (process_rank == 0) {
+            int64_t control_sum = calculateSumSequental(matrix);
+            ASSERT_EQ(control_sum, sum);
+        }
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Hybrid_Size_3x1_More_Threads_Than_Elements) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 3;
+    int cols = 1;
+    int elements_count = rows * cols;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    int64_t sum = calculateSumHybrid(matrix, elements_count, 8);
+    if (process_rank == 0) {
+        int64_t control_sum = calculateSumSequental(matrix);
+        ASSERT_EQ(control_sum, sum);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Hybrid_Cannot_Accept_Negative_Threads_Count) {
+    std::vector<int> matrix;
+    ASSERT_ANY_THROW(calculateSumHybrid(matrix, 0, -1));
+}
+
+// Compares one process per core with one process per node that runs a thread per core
+TEST(Parallel_Matrix_Sum_MPI, Performance_Pure_MPI_vs_Hybrid) {
+    int process_rank, process_count;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_count);
+    MPI_Comm node_comm, leaders_comm;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, process_rank, MPI_INFO_NULL, &node_comm);
+    int node_rank, node_size;
+    MPI_Comm_rank(node_comm, &node_rank);
+    MPI_Comm_size(node_comm, &node_size);
+    MPI_Comm_split(MPI_COMM_WORLD, node_rank == 0 ? 0 : MPI_UNDEFINED, process_rank, &leaders_comm);
+    const int sizes[] = { 100, 1000, 2000 };
+    for (int size : sizes) {
+        int elements_count = size * size;
+        std::vector<int> matrix;
+        if (process_rank == 0)
+            matrix = createRandomVector(elements_count);
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t1 = MPI_Wtime();
+        int64_t sum = calculateSumParallel(matrix, elements_count);
+        double t2 = MPI_Wtime();
+        int64_t hybrid_sum = 0;
+        if (leaders_comm != MPI_COMM_NULL)
+            hybrid_sum = calculateSumHybrid(matrix, elements_count, node_size, leaders_comm);
+        double t3 = MPI_Wtime();
+        if (process_rank == 0) {
+            std::cout << "cores=" << process_count << " size=" << size << "x" << size
+                      << ": pure_mpi=" << (t2 - t1) << ", hybrid=" << (t3 - t2) << std::endl;
+            ASSERT_EQ(sum, hybrid_sum);
+        }
+    }
+    if (leaders_comm != MPI_COMM_NULL)
+        MPI_Comm_free(&leaders_comm);
+    MPI_Comm_free(&node_comm);
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Grid_Size_0x0) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 0;
+    int cols = 0;
+    int elements_count = rows * cols;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    BlockCyclicMatrix grid_matrix(matrix, rows, cols, 4);
+    auto row_sums = grid_matrix.rowSums();
+    auto col_sums = grid_matrix.colSums();
+    int64_t block_sum = grid_matrix.blockSum(0, 0, 0, 0);
+    if (process_rank == 0) {
+        ASSERT_TRUE(row_sums.empty());
+        ASSERT_TRUE(col_sums.empty());
+        ASSERT_EQ(0, block_sum);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Grid_Size_1x1) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 1;
+    int cols = 1;
+    int elements_count = rows * cols;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    BlockCyclicMatrix grid_matrix(matrix, rows, cols, 4);
+    auto row_sums = grid_matrix.rowSums();
+    auto col_sums = grid_matrix.colSums();
+    int64_t block_sum = grid_matrix.blockSum(0, 0, 1, 1);
+    if (process_rank == 0) {
+        ASSERT_EQ(std::vector<int64_t>{ matrix[0] }, row_sums);
+        ASSERT_EQ(std::vector<int64_t>{ matrix[0] }, col_sums);
+        ASSERT_EQ(matrix[0], block_sum);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Grid_Size_100x200) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 100;
+    int cols = 200;
+    int elements_count = rows * cols;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    BlockCyclicMatrix grid_matrix(matrix, rows, cols, 16);
+    auto row_sums = grid_matrix.rowSums();
+    auto col_sums = grid_matrix.colSums();
+    int64_t block_sum = grid_matrix.blockSum(10, 20, 95, 137);
+    if (process_rank == 0) {
+        std::vector<int64_t> control_row_sums(rows, 0), control_col_sums(cols, 0);
+        int64_t control_block_sum = 0;
+        for (int i = 0; i < rows; i++)
+            for (int j = 0; j < cols; j++) {
+                int elem = matrix[i * cols + j];
+                control_row_sums[i] += elem;
+                control_col_sums[j] += elem;
+                if (i >= 10 && i < 95 && j >= 20 && j < 137)
+                    control_block_sum += elem;
+            }
+        ASSERT_EQ(control_row_sums, row_sums);
+        ASSERT_EQ(control_col_sums, col_sums);
+        ASSERT_EQ(control_block_sum, block_sum);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Grid_Size_51x2) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 51;
+    int cols = 2;
+    int elements_count = rows * cols;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    BlockCyclicMatrix grid_matrix(matrix, rows, cols, 3);
+    auto row_sums = grid_matrix.rowSums();
+    auto col_sums = grid_matrix.colSums();
+    int64_t block_sum = grid_matrix.blockSum(7, 1, 50, 2);
+    if (process_rank == 0) {
+        std::vector<int64_t> control_row_sums(rows, 0), control_col_sums(cols, 0);
+        int64_t control_block_sum = 0;
+        for (int i = 0; i < rows; i++)
+            for (int j = 0; j < cols; j++) {
+                int elem = matrix[i * cols + j];
+                control_row_sums[i] += elem;
+                control_col_sums[j] += elem;
+                if (i >= 7 && i < 50 && j >= 1)
+                    control_block_sum += elem;
+            }
+        ASSERT_EQ(control_row_sums, row_sums);
+        ASSERT_EQ(control_col_sums, col_sums);
+        ASSERT_EQ(control_block_sum, block_sum);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Grid_Cannot_Accept_Invalid_Block) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(6);
+    BlockCyclicMatrix grid_matrix(matrix, 2, 3);
+    ASSERT_ANY_THROW(grid_matrix.blockSum(0, 0, 3, 3));
+    ASSERT_ANY_THROW(grid_matrix.blockSum(1, 0, 0, 3));
+    ASSERT_ANY_THROW(BlockCyclicMatrix(matrix, 2, 3, 0));
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Pipelined_Size_51x2) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 51;
+    int cols = 2;
+    int elements_count = rows * cols;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    for (int chunk_size : { 1, 7, 50, 1000 }) {
+        PipelineStats stats;
+        int64_t sum = calculateSumPipelined(matrix, elements_count, chunk_size, &stats);
+        if (process_rank == 0) {
+            int64_t control_sum = calculateSumSequental(matrix);
+            ASSERT_EQ(control_sum, sum);
+            ASSERT_GT(stats.chunks_count, 0);
+            ASSERT_GE(stats.overlap, 0.);
+            ASSERT_LE(stats.overlap, 1.);
+        }
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Pipelined_Size_0x0) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    std::vector<int> matrix;
+    PipelineStats stats;
+    int64_t sum = calculateSumPipelined(matrix, 0, 16, &stats);
+    if (process_rank == 0) {
+        ASSERT_EQ(0, sum);
+        ASSERT_EQ(0, stats.chunks_count);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Pipelined_Cannot_Accept_Invalid_Chunk_Size) {
+    std::vector<int> matrix;
+    ASSERT_ANY_THROW(calculateSumPipelined(matrix, 0, 0));
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Performance_Pipelined_Chunk_Size) {
+    int process_rank, process_count;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_count);
+    int elements_count = 2000 * 2000;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    double t1 = MPI_Wtime();
+    int64_t control_sum = calculateSumParallel(matrix, elements_count);
+    double t2 = MPI_Wtime();
+    if (process_rank == 0)
+        std::cout << "procs=" << process_count << " scatterv: time=" << (t2 - t1) << std::endl;
+    for (int chunk_size : { 1 << 12, 1 << 14, 1 << 16, 1 << 18 }) {
+        PipelineStats stats;
+        int64_t sum = calculateSumPipelined(matrix, elements_count, chunk_size, &stats);
+        // Overlap is reported by the last process, the root sums its slice in place
+        if (process_count > 1 && process_rank == process_count - 1)
+            MPI_Send(&stats.overlap, 1, MPI_DOUBLE, 0, 0, MPI_COMM_WORLD);
+        if (process_rank == 0) {
+            double overlap = stats.overlap;
+            if (process_count > 1)
+                MPI_Recv(&overlap, 1, MPI_DOUBLE, process_count - 1, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            std::cout << "procs=" << process_count << " chunk=" << chunk_size << ": time=" << stats.total_time
+                      << ", chunks=" << stats.chunks_count << ", overlap=" << overlap << std::endl;
+            ASSERT_EQ(control_sum, sum);
+        }
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Distributed_Size_51x2) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 51;
+    int cols = 2;
+    int elements_count = rows * cols;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    DistributedVector<int> vector(matrix, elements_count);
+    int64_t sum = vector.sum();
+    int min = vector.min();
+    int max = vector.max();
+    double mean = vector.mean();
+    int64_t even_count = vector.countIf([](int elem) { return elem % 2 == 0; });
+    vector.transform([](int elem) { return elem * 3 - 1; });
+    int64_t transformed_sum = vector.sum();
+    std::vector<int> transformed = vector.gather();
+    if (process_rank == 0) {
+        int64_t control_sum = calculateSumSequental(matrix);
+        ASSERT_EQ(control_sum, sum);
+        ASSERT_EQ(*std::min_element(matrix.begin(), matrix.end()), min);
+        ASSERT_EQ(*std::max_element(matrix.begin(), matrix.end()), max);
+        ASSERT_DOUBLE_EQ(static_cast<double>(control_sum) / elements_count, mean);
+        ASSERT_EQ(std::count_if(matrix.begin(), matrix.end(), [](int elem) { return elem % 2 == 0; }), even_count);
+        ASSERT_EQ(control_sum * 3 - elements_count, transformed_sum);
+        for (int &elem : matrix)
+            elem = elem * 3 - 1;
+        ASSERT_EQ(matrix, transformed);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Distributed_Double_Size_3x1) {
+    std::vector<double> matrix = { 0.5, -2.25, 10. };
+    DistributedVector<double> vector(matrix, 3);
+    ASSERT_DOUBLE_EQ(8.25, vector.sum());
+    ASSERT_DOUBLE_EQ(-2.25, vector.min());
+    ASSERT_DOUBLE_EQ(10., vector.max());
+    ASSERT_DOUBLE_EQ(2.75, vector.mean());
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Distributed_Char_Min_Max) {
+    std::string text = "distributed vector of chars";
+    std::vector<char> matrix(text.begin(), text.end());
+    DistributedVector<char> vector(matrix, static_cast<int>(matrix.size()));
+    ASSERT_EQ(' ', vector.min());
+    ASSERT_EQ('v', vector.max());
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Distributed_Size_0x0) {
+    std::vector<int> matrix;
+    DistributedVector<int> vector(matrix, 0);
+    ASSERT_EQ(0, vector.sum());
+    ASSERT_EQ(0, vector.countIf([](int) { return true; }));
+    ASSERT_ANY_THROW(vector.min());
+    ASSERT_ANY_THROW(vector.mean());
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Performance_Repeated_Reductions) {
+    int process_rank, process_count;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_count);
+    const int repeats = 50;
+    int elements_count = 1000 * 1000;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    double t1 = MPI_Wtime();
+    int64_t sum = 0;
+    for (int i = 0; i < repeats; i++)
+        sum = calculateSumParallel(matrix, elements_count);
+    double t2 = MPI_Wtime();
+    DistributedVector<int> vector(matrix, elements_count);
+    int64_t resident_sum = 0;
+    for (int i = 0; i < repeats; i++)
+        resident_sum = vector.sum();
+    double t3 = MPI_Wtime();
+    if (process_rank == 0) {
+        std::cout << "procs=" << process_count << " repeats=" << repeats << ": scatter_every_time=" << (t2 - t1)
+                  << ", resident=" << (t3 - t2) << std::endl;
+        ASSERT_EQ(sum, resident_sum);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Reduction_Fused_Statistics_Size_100x200) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 100;
+    int cols = 200;
+    int elements_count = rows * cols;
+    std::vector<int> matrix;
+    if (process_rank == 0)
+        matrix = createRandomVector(elements_count);
+    using Statistics =
+        Reduction::Fuse<Reduction::Sum<int>,
+                        Reduction::Fuse<Reduction::MinMax<int>,
+                                        Reduction::Fuse<Reduction::ArgMax<int>, Reduction::Welford<int>>>>;
+    auto result = Reduction::reduce<Statistics>(matrix, elements_count);
+    if (process_rank == 0) {
+        int64_t control_sum = calculateSumSequental(matrix);
+        auto max_it = std::max_element(matrix.begin(), matrix.end());
+        double mean = static_cast<double>(control_sum) / elements_count;
+        double m2 = 0.;
+        for (int elem : matrix)
+            m2 += (elem - mean) * (elem - mean);
+        ASSERT_EQ(control_sum, result.first);
+        ASSERT_EQ(*std::min_element(matrix.begin(), matrix.end()), result.second.first.min);
+        ASSERT_EQ(*max_it, result.second.first.max);
+        ASSERT_EQ(*max_it, result.second.second.first.value);
+        ASSERT_EQ(max_it - matrix.begin(), result.second.second.first.index);
+        ASSERT_EQ(elements_count, result.second.second.second.count);
+        ASSERT_NEAR(mean, result.second.second.second.mean, 1e-9);
+        ASSERT_NEAR(m2 / elements_count, result.second.second.second.variance(), 1e-6);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Reduction_Size_0x0) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    std::vector<double> matrix;
+    auto argmax = Reduction::reduce<Reduction::ArgMax<double>>(matrix, 0);
+    auto welford = Reduction::reduce<Reduction::Welford<double>>(matrix, 0);
+    if (process_rank == 0) {
+        ASSERT_EQ(-1, argmax.index);
+        ASSERT_EQ(0, welford.count);
+    }
+}
+
+struct Cell {
+    int row;
+    int col;
+    double weight;
+};
+
+// Custom operator over a custom element type: the weight of the heaviest cell of each parity
+struct HeaviestByParity {
+    struct value_type {
+        double weight[2];
+    };
+    static value_type identity() {
+        return { { 0., 0. } };
+    }
+    static void add(value_type* acc, const Cell& cell, int64_t) {
+        int parity = (cell.row + cell.col) % 2;
+        if (cell.weight > acc->weight[parity])
+            acc->weight[parity] = cell.weight;
+    }
+    static void merge(value_type* acc, const value_type& other) {
+        for (int parity = 0; parity < 2; parity++)
+            if (other.weight[parity] > acc->weight[parity])
+                acc->weight[parity] = other.weight[parity];
+    }
+};
+
+TEST(Parallel_Matrix_Sum_MPI, Reduction_Custom_Type_Size_51x2) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 51;
+    int cols = 2;
+    int elements_count = rows * cols;
+    std::vector<Cell> cells;
+    if (process_rank == 0) {
+        std::vector<int> weights = createRandomVector(elements_count, 51);
+        for (int i = 0; i < rows; i++)
+            for (int j = 0; j < cols; j++)
+                cells.push_back({ i, j, weights[i * cols + j] / 10. });
+    }
+    auto result = Reduction::reduce<HeaviestByParity>(cells, elements_count);
+    if (process_rank == 0) {
+        double expected[2] = { 0., 0. };
+        for (const Cell& cell : cells)
+            expected[(cell.row + cell.col) % 2] = std::max(expected[(cell.row + cell.col) % 2], cell.weight);
+        ASSERT_DOUBLE_EQ(expected[0], result.weight[0]);
+        ASSERT_DOUBLE_EQ(expected[1], result.weight[1]);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Prepared_Size_51x2_Repeated) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 51;
+    int cols = 2;
+    int elements_count = rows * cols;
+    PreparedSum prepared_sum(elements_count);
+    for (int repeat = 0; repeat < 5; repeat++) {
+        std::vector<int> matrix;
+        if (process_rank == 0) {
+            matrix = createRandomVector(elements_count);
+            std::copy(matrix.begin(), matrix.end(), prepared_sum.data());
+        }
+        int64_t sum = prepared_sum.run();
+        if (process_rank == 0) {
+            int64_t control_sum = calculateSumSequental(matrix);
+            ASSERT_EQ(control_sum, sum);
+        }
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Prepared_Size_0x0) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    PreparedSum prepared_sum(0);
+    int64_t sum = prepared_sum.run();
+    if (process_rank == 0) {
+        ASSERT_EQ(0, sum);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Performance_Prepared_Per_Call_Latency) {
+    int process_rank, process_count;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_count);
+    const int repeats = 1000;
+    const int sizes[] = { 4, 16, 64 };
+    for (int size : sizes) {
+        int elements_count = size * size;
+        std::vector<int> matrix;
+        if (process_rank == 0)
+            matrix = createRandomVector(elements_count);
+        PreparedSum prepared_sum(elements_count);
+        if (process_rank == 0)
+            std::copy(matrix.begin(), matrix.end(), prepared_sum.data());
+        int64_t sum = 0, prepared = 0;
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t1 = MPI_Wtime();
+        for (int i = 0; i < repeats; i++)
+            sum = calculateSumParallel(matrix, elements_count);
+        double t2 = MPI_Wtime();
+        for (int i = 0; i < repeats; i++)
+            prepared = prepared_sum.run();
+        double t3 = MPI_Wtime();
+        if (process_rank == 0) {
+            std::cout << "procs=" << process_count << " size=" << size << "x" << size
+                      << ": per_call=" << (t2 - t1) / repeats << ", prepared=" << (t3 - t2) / repeats << std::endl;
+            ASSERT_EQ(sum, prepared);
+        }
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, File_Size_101x37) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    int rows = 101;
+    int cols = 37;
+    int elements_count = rows * cols;
+    const char *file_name = "matrix_sum_101x37.bin";
+    std::vector<int> matrix;
+    if (process_rank == 0) {
+        matrix = createRandomVector(elements_count);
+        writeMatrixFile(file_name, matrix);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    int64_t sum = calculateSumFromFile(file_name, cols, 50);
+    int64_t sum_single_chunk = calculateSumFromFile(file_name, cols);
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (process_rank == 0) {
+        std::remove(file_name);
+        int64_t control_sum = calculateSumSequental(matrix);
+        ASSERT_EQ(control_sum, sum);
+        ASSERT_EQ(control_sum, sum_single_chunk);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, File_Size_0x10) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    const char *file_name = "matrix_sum_0x10.bin";
+    if (process_rank == 0)
+        writeMatrixFile(file_name, std::vector<int>());
+    MPI_Barrier(MPI_COMM_WORLD);
+    int64_t sum = calculateSumFromFile(file_name, 10, 4);
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (process_rank == 0) {
+        std::remove(file_name);
+        ASSERT_EQ(0, sum);
+    }
+}
+
+TEST(Parallel_Matrix_Sum_MPI, File_Cannot_Sum_Partial_Row) {
+    int process_rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    const char *file_name = "matrix_sum_partial_row.bin";
+    if (process_rank == 0)
+        writeMatrixFile(file_name, std::vector<int>(25, 1));
+    MPI_Barrier(MPI_COMM_WORLD);
+    ASSERT_ANY_THROW(calculateSumFromFile(file_name, 10));
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (process_rank == 0)
+        std::remove(file_name);
+}
+
+TEST(Parallel_Matrix_Sum_MPI, File_Cannot_Open_Missing_File) {
+    ASSERT_ANY_THROW(calculateSumFromFile("matrix_sum_missing.bin", 10));
+}
+
+TEST(Matrix_Sum_Random, Philox_Known_Answer) {
+    uint32_t counter[4] = { 0, 0, 0, 0 };
+    CounterRandom::philox4x32(counter, 0);
+    ASSERT_EQ(0x6627e8d5u, counter[0]);
+    ASSERT_EQ(0xe169c58du, counter[1]);
+    ASSERT_EQ(0xbc57ac4cu, counter[2]);
+    ASSERT_EQ(0x9b00dbd8u, counter[3]);
+    std::vector<int> vector = createRandomVectorPart(0, 0, 4);
+    for (int i = 0; i < 4; i++)
+        ASSERT_EQ(static_cast<int>((static_cast<uint64_t>(counter[i]) * 100u) >> 32), vector[i]);
+}
+
+TEST(Matrix_Sum_Random, Same_Seed_Same_Vector) {
+    std::vector<int> vector = createRandomVector(100003, 42);
+    ASSERT_EQ(vector, createRandomVector(100003, 42));
+    ASSERT_NE(vector, createRandomVector(100003, 43));
+    for (int elem : vector) {
+        ASSERT_GE(elem, 0);
+        ASSERT_LT(elem, 100);
+    }
+    std::vector<int> part = createRandomVectorPart(42, 77, 1001);
+    ASSERT_EQ(std::vector<int>(vector.begin() + 77, vector.begin() + 1078), part);
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Random_Parts_Independent_Of_Process_Count) {
+    int process_rank, process_count;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_count);
+    int rows = 51;
+    int cols = 2;
+    int elements_count = rows * cols;
+    const uint64_t seed = 2020;
+    std::vector<int> counts, displs;
+    calculatePartition(elements_count, process_count, &counts, &displs);
+    std::vector<int> part = createRandomVectorPart(seed, displs[process_rank], counts[process_rank]);
+    std::vector<int> matrix(process_rank == 0 ? elements_count : 0);
+    MPI_Gatherv(part.data(), counts[process_rank], MPI_INT, matrix.data(), counts.data(), displs.data(), MPI_INT, 0,
+                MPI_COMM_WORLD);
+    if (process_rank == 0) {
+        ASSERT_EQ(createRandomVector(elements_count, seed), matrix);
+    }
+}
+
+TEST(Matrix_Sum_Kernels, Int64_Same_Result_For_Every_Isa) {
+    std::vector<int> vector = createRandomVector(1037);
+    vector[5] = INT_MIN;
+    vector[1000] = INT_MAX;
+    int64_t control_sum = 0;
+    for (int elem : vector)
+        control_sum += elem;
+    const SumKernels::Isa isas[] = { SumKernels::Isa::Scalar, SumKernels::Isa::SSE2, SumKernels::Isa::AVX2 };
+    for (SumKernels::Isa isa : isas) {
+        if (static_cast<int>(isa) > static_cast<int>(SumKernels::detectIsa()))
+            continue;
+        for (size_t count : { size_t(0), size_t(3), size_t(17), vector.size() }) {
+            int64_t expected = 0;
+            for (size_t i = 0; i < count; i++)
+                expected += vector[i];
+            ASSERT_EQ(expected, SumKernels::sumInt64(vector.data(), count, isa));
+        }
+    }
+    ASSERT_EQ(control_sum, SumKernels::sum<SumKernels::Int64>(vector.data(), vector.size()));
+}
+
+TEST(Matrix_Sum_Kernels, Compensated_Keeps_Small_Terms) {
+    std::vector<double> vector = { 1., 1e100, 1., -1e100 };
+    ASSERT_EQ(2., SumKernels::sum<SumKernels::Compensated>(vector.data(), vector.size()));
+}
+
+TEST(Matrix_Sum_Kernels, Double_Same_Result_For_Every_Isa) {
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<double> dist(-1e10, 1e10);
+    std::vector<double> vector(1037);
+    for (auto &elem : vector)
+        elem = dist(gen);
+    vector[10] = 1e100;
+    vector[700] = -1e100;
+    const SumKernels::Isa isas[] = { SumKernels::Isa::Scalar, SumKernels::Isa::SSE2, SumKernels::Isa::AVX2 };
+    for (SumKernels::Isa isa : isas) {
+        if (static_cast<int>(isa) > static_cast<int>(SumKernels::detectIsa())) {
+            ASSERT_ANY_THROW(SumKernels::sumCompensatedDouble(vector.data(), vector.size(), isa));
+            continue;
+        }
+        for (size_t count : { size_t(0), size_t(3), size_t(17), size_t(300), vector.size() }) {
+            ASSERT_EQ(SumKernels::sumCompensated(vector.data(), count),
+                      SumKernels::sumCompensatedDouble(vector.data(), count, isa));
+            ASSERT_EQ(SumKernels::sumPairwise(vector.data(), count),
+                      SumKernels::sumPairwiseDouble(vector.data(), count, isa));
+        }
+    }
+}
+
+TEST(Matrix_Sum_Kernels, Pairwise_Is_Accurate) {
+    std::vector<float> vector(1000000, 0.1f);
+    double expected = 1000000 * static_cast<double>(0.1f);
+    ASSERT_NEAR(expected, SumKernels::sum<SumKernels::Pairwise>(vector.data(), vector.size()), 1e-6);
+    ASSERT_NEAR(expected, SumKernels::sum<SumKernels::Compensated>(vector.data(), vector.size()), 1e-6);
+}
+
+TEST(Parallel_Matrix_Sum_MPI, Performance_Scatterv_vs_SendRecv) {
+    int process_rank, process_count;
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &process_count);
+    const int sizes[] = { 100, 500, 1000, 2000 };
+    for (int size : sizes) {
+        int elements_count = size * size;
+        std::vector<int> matrix;
+        if (process_rank == 0)
+            matrix = createRandomVector(elements_count);
+        double t1 = MPI_Wtime();
+        int64_t sum = calculateSumParallel(matrix, elements_count);
+        double t2 = MPI_Wtime();
+        int64_t control_sum = calculateSumParallelSendRecv(matrix, elements_count);
+        double t3 = MPI_Wtime();
+        if (process_rank == 0) {
+            std::cout << "procs=" << process_count << " size=" << size << "x" << size
+                      << ": scatterv=" << (t2 - t1) << ", send_recv=" << (t3 - t2) << std::endl;
+            ASSERT_EQ(control_sum, sum);
+        }
+    }
+}
+
 int main(int argc, char* argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     MPI_Init(&argc, &argv);
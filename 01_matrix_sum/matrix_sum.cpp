@@ -1,24 +1,210 @@
 // Copyright 2020 Vlasov Maksim
 #include <mpi.h>
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
 #include <vector>
 #include <random>
-#include <numeric>
+#include "counter_random.h"
 #include "matrix_sum.h"
+#include "sum_kernels.h"
 
 std::vector<int> createRandomVector(int elements_count) {
     std::random_device rd;
-    std::mt19937 generator(rd());
+    uint64_t seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+    return createRandomVector(elements_count, seed);
+}
+
+std::vector<int> createRandomVector(int elements_count, uint64_t seed) {
     std::vector<int> result(elements_count);
-    for (int& elem : result)
-        elem = static_cast<int>(generator() % 100u);
+    // Small vectors are not worth starting threads for
+    int num_threads = elements_count < (1 << 16) ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    CounterRandom::fillParallel(seed, 0, elements_count, 100u, result.data(), num_threads);
+    return result;
+}
+
+std::vector<int> createRandomVectorPart(uint64_t seed, int64_t begin, int count) {
+    std::vector<int> result(count);
+    CounterRandom::fill(seed, begin, count, 100u, result.data());
     return result;
 }
 
-int calculateSumSequental(const std::vector<int> &vector) {
-    return std::accumulate(vector.begin(), vector.end(), 0);
+void calculatePartition(int elements_count, int process_count, std::vector<int> *counts, std::vector<int> *displs) {
+    int delta = elements_count / process_count;
+    int remain = elements_count - delta * process_count;
+    counts->resize(process_count);
+    displs->resize(process_count);
+    for (int process_num = 0, displ = 0; process_num < process_count; process_num++) {
+        counts->at(process_num) = process_num < remain ? delta + 1 : delta;
+        displs->at(process_num) = displ;
+        displ += counts->at(process_num);
+    }
+}
+
+int64_t calculateSumSequental(const std::vector<int> &vector) {
+    return SumKernels::sum<SumKernels::Int64>(vector.data(), vector.size());
+}
+
+// Scatters the vector from the process 0 of comm and returns the slice of the current process.
+// The root process does not receive its own slice, the pointer refers to the source vector instead.
+static const int *scatterPart(const std::vector<int> &vector, int elements_count, MPI_Comm comm,
+                              std::vector<int> *part_vector, int *part_count) {
+    int process_count, process_rank;
+    MPI_Comm_size(comm, &process_count);
+    MPI_Comm_rank(comm, &process_rank);
+    std::vector<int> counts, displs;
+    calculatePartition(elements_count, process_count, &counts, &displs);
+    *part_count = counts[process_rank];
+    if (process_rank == 0) {
+        MPI_Scatterv(vector.data(), counts.data(), displs.data(), MPI_INT, MPI_IN_PLACE, *part_count, MPI_INT, 0,
+                     comm);
+        return vector.data() + displs[0];
+    }
+    part_vector->resize(*part_count);
+    MPI_Scatterv(nullptr, nullptr, nullptr, MPI_INT, part_vector->data(), *part_count, MPI_INT, 0, comm);
+    return part_vector->data();
+}
+
+int64_t calculateSumParallel(const std::vector<int> &vector, int elements_count) {
+    std::vector<int> part_vector;
+    int part_count;
+    const int *part = scatterPart(vector, elements_count, MPI_COMM_WORLD, &part_vector, &part_count);
+    using Accumulator = SumKernels::Int64;
+    Accumulator::value_type sum = 0;
+    Accumulator::value_type part_sum = SumKernels::sum<Accumulator>(part, part_count);
+    MPI_Reduce(&part_sum, &sum, 1, Accumulator::datatype(), MPI_SUM, 0, MPI_COMM_WORLD);
+    return sum;
+}
+
+int64_t calculateSumHybrid(const std::vector<int> &vector, int elements_count, int num_threads, MPI_Comm comm) {
+    if (num_threads < 0)
+        throw std::runtime_error("Number of threads must not be negative");
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> part_vector;
+    int part_count;
+    const int *part = scatterPart(vector, elements_count, comm, &part_vector, &part_count);
+
+    using Accumulator = SumKernels::Int64;
+    // Every partial sum occupies its own cache line, so threads never write to a shared one. The slots are
+    // aligned by hand: std::allocator ignores alignas above the fundamental alignment before C++17
+    using value_type = Accumulator::value_type;
+    const size_t cache_line = 64;
+    const size_t stride = cache_line / sizeof(value_type);
+    std::vector<value_type> thread_sums((num_threads + 1) * stride);
+    size_t first_slot = (cache_line - reinterpret_cast<uintptr_t>(thread_sums.data()) % cache_line) % cache_line /
+                        sizeof(value_type);
+    auto slot = [&](int t_id) -> value_type & { return thread_sums[first_slot + t_id * stride]; };
+    std::vector<int> thread_counts, thread_displs;
+    calculatePartition(part_count, num_threads, &thread_counts, &thread_displs);
+    auto runner = [&](int t_id) {
+        slot(t_id) = SumKernels::sum<Accumulator>(part + thread_displs[t_id], thread_counts[t_id]);
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(num_threads - 1);
+    for (int t_id = 1; t_id < num_threads; t_id++)
+        threads.emplace_back(runner, t_id);
+    runner(0);
+    for (auto &thread : threads)
+        thread.join();
+
+    Accumulator::value_type sum = 0;
+    Accumulator::value_type part_sum = 0;
+    for (int t_id = 0; t_id < num_threads; t_id++)
+        part_sum += slot(t_id);
+    MPI_Reduce(&part_sum, &sum, 1, Accumulator::datatype(), MPI_SUM, 0, comm);
+    return sum;
+}
+
+int64_t calculateSumPipelined(const std::vector<int> &vector, int elements_count, int chunk_size,
+                              PipelineStats *stats) {
+    if (chunk_size <= 0)
+        throw std::runtime_error("Chunk size must be positive");
+    double t_begin = MPI_Wtime();
+    int process_count, process_rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_count);
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    std::vector<int> counts, displs;
+    calculatePartition(elements_count, process_count, &counts, &displs);
+    // The process 0 has the largest slice, so it defines the number of rounds
+    int chunks_count = (counts[0] + chunk_size - 1) / chunk_size;
+    auto chunkLength = [&](int process_num, int chunk) {
+        int offset = chunk * chunk_size;
+        return offset < counts[process_num] ? std::min(chunk_size, counts[process_num] - offset) : 0;
+    };
+
+    // Two chunks are in use at a time: one is being summed, the next one is in flight
+    std::vector<int> buffers[2];
+    std::vector<int> chunk_counts[2], chunk_displs[2];
+    MPI_Request requests[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+    for (int slot = 0; slot < 2; slot++) {
+        if (process_rank == 0) {
+            chunk_counts[slot].resize(process_count);
+            chunk_displs[slot].resize(process_count);
+        } else {
+            buffers[slot].resize(std::min(chunk_size, counts[process_rank]));
+        }
+    }
+    auto startChunk = [&](int chunk) {
+        int slot = chunk % 2;
+        if (process_rank == 0) {
+            for (int process_num = 0; process_num < process_count; process_num++) {
+                chunk_counts[slot][process_num] = chunkLength(process_num, chunk);
+                chunk_displs[slot][process_num] = displs[process_num] + std::min(chunk * chunk_size, counts[process_num]);
+            }
+            MPI_Iscatterv(vector.data(), chunk_counts[slot].data(), chunk_displs[slot].data(), MPI_INT, MPI_IN_PLACE,
+                          chunk_counts[slot][0], MPI_INT, 0, MPI_COMM_WORLD, &requests[slot]);
+        } else {
+            MPI_Iscatterv(nullptr, nullptr, nullptr, MPI_INT, buffers[slot].data(), chunkLength(process_rank, chunk),
+                          MPI_INT, 0, MPI_COMM_WORLD, &requests[slot]);
+        }
+    };
+
+    using Accumulator = SumKernels::Int64;
+    const int piece_size = 1 << 14;
+    Accumulator::value_type sum = 0;
+    Accumulator::value_type part_sum = 0;
+    double wait_time = 0., overlapped_time = 0.;
+    if (chunks_count > 0)
+        startChunk(0);
+    for (int chunk = 0; chunk < chunks_count; chunk++) {
+        int slot = chunk % 2;
+        bool has_next = chunk + 1 < chunks_count;
+        if (has_next)
+            startChunk(chunk + 1);
+        double t1 = MPI_Wtime();
+        MPI_Wait(&requests[slot], MPI_STATUS_IGNORE);
+        double t2 = MPI_Wtime();
+        const int *data =
+            process_rank == 0 ? vector.data() + displs[0] + chunk * chunk_size : buffers[slot].data();
+        int length = chunkLength(process_rank, chunk);
+        for (int offset = 0; offset < length; offset += piece_size) {
+            part_sum += SumKernels::sum<Accumulator>(data + offset, std::min(piece_size, length - offset));
+            if (has_next) {
+                int flag;
+                MPI_Test(&requests[1 - slot], &flag, MPI_STATUS_IGNORE);
+            }
+        }
+        double t3 = MPI_Wtime();
+        wait_time += t2 - t1;
+        if (has_next)
+            overlapped_time += t3 - t2;
+    }
+    MPI_Reduce(&part_sum, &sum, 1, Accumulator::datatype(), MPI_SUM, 0, MPI_COMM_WORLD);
+    if (stats != nullptr) {
+        stats->chunks_count = chunks_count;
+        stats->total_time = MPI_Wtime() - t_begin;
+        stats->wait_time = wait_time;
+        stats->overlapped_time = overlapped_time;
+        stats->overlap = overlapped_time + wait_time > 0. ? overlapped_time / (overlapped_time + wait_time) : 0.;
+    }
+    return sum;
 }
 
-int calculateSumParallel(const std::vector<int> &vector, int elements_count) {
+int64_t calculateSumParallelSendRecv(const std::vector<int> &vector, int elements_count) {
     int process_count, process_rank;
     MPI_Comm_size(MPI_COMM_WORLD, &process_count);
     MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
@@ -36,8 +222,77 @@ int calculateSumParallel(const std::vector<int> &vector, int elements_count) {
         MPI_Status status;
         MPI_Recv(part_vector.data(), delta, MPI_INT, 0, 0, MPI_COMM_WORLD, &status);
     }
-    int sum = 0;
-    int part_sum = calculateSumSequental(part_vector);
-    MPI_Reduce(&part_sum, &sum, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+    int64_t sum = 0;
+    int64_t part_sum = calculateSumSequental(part_vector);
+    MPI_Reduce(&part_sum, &sum, 1, MPI_INT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    return sum;
+}
+
+void writeMatrixFile(const std::string &file_name, const std::vector<int> &matrix) {
+    std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("Unable to create matrix file");
+    file.write(reinterpret_cast<const char *>(matrix.data()), matrix.size() * sizeof(int));
+}
+
+int64_t calculateSumFromFile(const std::string &file_name, int cols, int chunk_size) {
+    if (cols <= 0)
+        throw std::runtime_error("Columns count must be positive");
+    if (chunk_size <= 0)
+        throw std::runtime_error("Chunk size must be positive");
+    int process_count, process_rank;
+    MPI_Comm_size(MPI_COMM_WORLD, &process_count);
+    MPI_Comm_rank(MPI_COMM_WORLD, &process_rank);
+    MPI_File file;
+    if (MPI_File_open(MPI_COMM_WORLD, file_name.c_str(), MPI_MODE_RDONLY, MPI_INFO_NULL, &file) != MPI_SUCCESS)
+        throw std::runtime_error("Unable to open matrix file");
+    MPI_Offset file_size;
+    MPI_File_get_size(file, &file_size);
+    MPI_Offset row_bytes = static_cast<MPI_Offset>(sizeof(int)) * cols;
+    if (file_size % row_bytes != 0) {
+        MPI_File_close(&file);
+        throw std::runtime_error("Matrix file size is not a multiple of the row size");
+    }
+    // Same partition as calculatePartition, but in MPI_Offset: a large file may have more than INT_MAX rows
+    MPI_Offset rows = file_size / row_bytes;
+    MPI_Offset delta = rows / process_count, remain = rows % process_count;
+    MPI_Offset part_rows = process_rank < remain ? delta + 1 : delta;
+    MPI_Offset first_row = process_rank * delta + std::min<MPI_Offset>(process_rank, remain);
+    MPI_Offset part_begin = first_row * cols;
+    MPI_Offset part_count = part_rows * cols;
+    // Reads are collective, so every process issues as many of them as the one with the largest block
+    MPI_Offset max_part_count = (remain > 0 ? delta + 1 : delta) * cols;
+    MPI_Offset chunks_count = (max_part_count + chunk_size - 1) / chunk_size;
+
+    auto chunkLength = [&](MPI_Offset chunk) {
+        MPI_Offset offset = chunk * chunk_size;
+        return offset < part_count ? static_cast<int>(std::min<MPI_Offset>(chunk_size, part_count - offset)) : 0;
+    };
+    int buffer_size = static_cast<int>(std::min<MPI_Offset>(chunk_size, part_count));
+    std::vector<int> buffers[2] = { std::vector<int>(buffer_size), std::vector<int>(buffer_size) };
+    auto readChunk = [&](MPI_Offset chunk, MPI_Request *request) {
+        MPI_Offset offset = (part_begin + chunk * chunk_size) * static_cast<MPI_Offset>(sizeof(int));
+        std::vector<int> &buffer = buffers[chunk % 2];
+#if MPI_VERSION > 3 || (MPI_VERSION == 3 && MPI_SUBVERSION >= 1)
+        MPI_File_iread_at_all(file, offset, buffer.data(), chunkLength(chunk), MPI_INT, request);
+#else
+        MPI_File_iread_at(file, offset, buffer.data(), chunkLength(chunk), MPI_INT, request);
+#endif
+    };
+
+    using Accumulator = SumKernels::Int64;
+    Accumulator::value_type sum = 0;
+    Accumulator::value_type part_sum = 0;
+    MPI_Request request;
+    if (chunks_count > 0)
+        readChunk(0, &request);
+    for (MPI_Offset chunk = 0; chunk < chunks_count; chunk++) {
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        if (chunk + 1 < chunks_count)
+            readChunk(chunk + 1, &request);
+        part_sum += SumKernels::sum<Accumulator>(buffers[chunk % 2].data(), chunkLength(chunk));
+    }
+    MPI_File_close(&file);
+    MPI_Reduce(&part_sum, &sum, 1, Accumulator::datatype(), MPI_SUM, 0, MPI_COMM_WORLD);
     return sum;
 }
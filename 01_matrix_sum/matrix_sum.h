@@ -1,8 +1,89 @@
 // Copyright 2020 Vlasov Maksim
 #pragma once
 
+#include <mpi.h>
+#include <cstdint>
+#include <string>
 #include <vector>
 
+/**
+ * Random vectors are generated by a counter-based generator (see counter_random.h):
+ * the element with index i depends only on the seed and on i. So a process may
+ * generate just its own part with createRandomVectorPart, and the data are the
+ * same as createRandomVector with the same seed produces for any process count.
+ */
 std::vector<int> createRandomVector(int elements_count);
-int calculateSumSequental(const std::vector<int> &vector);
-int calculateSumParallel(const std::vector<int> &vector, int elements_count);
+std::vector<int> createRandomVector(int elements_count, uint64_t seed);
+// Elements [begin, begin + count) of createRandomVector(..., seed)
+std::vector<int> createRandomVectorPart(uint64_t seed, int64_t begin, int count);
+
+/**
+ * Splits elements_count elements between process_count processes so that
+ * the first (elements_count % process_count) processes get one extra element.
+ * The result is suitable for MPI_Scatterv/MPI_Gatherv.
+ */
+void calculatePartition(int elements_count, int process_count, std::vector<int> *counts, std::vector<int> *displs);
+
+// Sums are accumulated in int64_t, see sum_kernels.h
+int64_t calculateSumSequental(const std::vector<int> &vector);
+
+/**
+ * Distributes the vector with a single MPI_Scatterv. The root process does not
+ * receive or copy its own slice, it is summed directly from the source vector.
+ */
+int64_t calculateSumParallel(const std::vector<int> &vector, int elements_count);
+
+/**
+ * Hybrid version intended to run with one process per node (or NUMA domain).
+ * The vector is distributed between the processes of comm as in calculateSumParallel,
+ * then every process splits its slice between num_threads threads
+ * (0 means std::thread::hardware_concurrency()). Thread partial sums are
+ * reduced locally before the single MPI_Reduce to the process 0 of comm.
+ */
+int64_t calculateSumHybrid(const std::vector<int> &vector, int elements_count, int num_threads = 0,
+                           MPI_Comm comm = MPI_COMM_WORLD);
+
+struct PipelineStats {
+    int chunks_count = 0;
+    double total_time = 0.;
+    // Time spent blocked in MPI_Wait for the current chunk
+    double wait_time = 0.;
+    // Time spent summing while the next chunk was in flight
+    double overlapped_time = 0.;
+    // Share of the transfer time the process spent summing instead of waiting:
+    // overlapped_time / (overlapped_time + wait_time)
+    double overlap = 0.;
+};
+
+/**
+ * Pipelined version: every slice is split into chunks of chunk_size elements
+ * which are distributed with one MPI_Iscatterv per chunk. Chunk k is summed
+ * while chunk k + 1 is being transferred; the summation is done in pieces
+ * with MPI_Test in between to drive progress of the transfer.
+ * If stats is not null, it is filled with the timings of the current process.
+ */
+int64_t calculateSumPipelined(const std::vector<int> &vector, int elements_count, int chunk_size = 1 << 16,
+                              PipelineStats *stats = nullptr);
+
+/**
+ * Former implementation: the root process sends every slice with a separate
+ * blocking MPI_Send. Kept for performance comparison.
+ */
+int64_t calculateSumParallelSendRecv(const std::vector<int> &vector, int elements_count);
+
+/**
+ * Writes the matrix as raw int elements in row-major order,
+ * the file can be summed with calculateSumFromFile.
+ */
+void writeMatrixFile(const std::string &file_name, const std::vector<int> &matrix);
+
+/**
+ * Sums a binary file of int elements (see writeMatrixFile) with cols columns
+ * without loading it on a single process.
+ *
+ * Every process reads only its own block of rows with collective MPI-IO reads
+ * of at most chunk_size elements. The next chunk is read while the current one
+ * is being summed, so a process never holds more than two chunks in memory.
+ * The file must hold a whole number of rows.
+ */
+int64_t calculateSumFromFile(const std::string &file_name, int cols, int chunk_size = 1 << 20);
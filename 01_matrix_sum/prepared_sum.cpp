@@ -0,0 +1,84 @@
+// Copyright 2020 Vlasov Maksim
+#include <mpi.h>
+#include <cstdint>
+#include <vector>
+#include "matrix_sum.h"
+#include "prepared_sum.h"
+#include "sum_kernels.h"
+
+PreparedSum::PreparedSum(int elements_count, MPI_Comm comm) : part_sum_(0), sum_(0) {
+    // Own communicator keeps persistent point-to-point requests away from other traffic
+    MPI_Comm_dup(comm, &comm_);
+    MPI_Comm_size(comm_, &process_count_);
+    MPI_Comm_rank(comm_, &process_rank_);
+    calculatePartition(elements_count, process_count_, &counts_, &displs_);
+    buffer_.resize(process_rank_ == 0 ? elements_count : counts_[process_rank_]);
+#if MPI_VERSION >= 4
+    requests_.resize(2);
+    if (process_rank_ == 0)
+        MPI_Scatterv_init(buffer_.data(), counts_.data(), displs_.data(), MPI_INT, MPI_IN_PLACE, counts_[0], MPI_INT,
+                          0, comm_, MPI_INFO_NULL, &requests_[0]);
+    else
+        MPI_Scatterv_init(nullptr, nullptr, nullptr, MPI_INT, buffer_.data(), counts_[process_rank_], MPI_INT, 0,
+                          comm_, MPI_INFO_NULL, &requests_[0]);
+    MPI_Reduce_init(&part_sum_, &sum_, 1, MPI_INT64_T, MPI_SUM, 0, comm_, MPI_INFO_NULL, &requests_[1]);
+#else
+    if (process_rank_ == 0) {
+        // Slices to every other process followed by receives of their partial sums
+        part_sums_.resize(process_count_);
+        requests_.resize(2 * (process_count_ - 1));
+        for (int process_num = 1; process_num < process_count_; process_num++) {
+            MPI_Send_init(buffer_.data() + displs_[process_num], counts_[process_num], MPI_INT, process_num, 0, comm_,
+                          &requests_[process_num - 1]);
+            MPI_Recv_init(&part_sums_[process_num], 1, MPI_INT64_T, process_num, 1, comm_,
+                          &requests_[process_count_ - 2 + process_num]);
+        }
+    } else {
+        requests_.resize(2);
+        MPI_Recv_init(buffer_.data(), counts_[process_rank_], MPI_INT, 0, 0, comm_, &requests_[0]);
+        MPI_Send_init(&part_sum_, 1, MPI_INT64_T, 0, 1, comm_, &requests_[1]);
+    }
+#endif
+}
+
+PreparedSum::~PreparedSum() {
+    for (auto &request : requests_)
+        MPI_Request_free(&request);
+    MPI_Comm_free(&comm_);
+}
+
+int *PreparedSum::data() {
+    return process_rank_ == 0 ? buffer_.data() : nullptr;
+}
+
+int64_t PreparedSum::run() {
+    const int *part = process_rank_ == 0 ? buffer_.data() + displs_[0] : buffer_.data();
+    int part_count = counts_[process_rank_];
+#if MPI_VERSION >= 4
+    MPI_Start(&requests_[0]);
+    MPI_Wait(&requests_[0], MPI_STATUS_IGNORE);
+    part_sum_ = SumKernels::sum<SumKernels::Int64>(part, part_count);
+    MPI_Start(&requests_[1]);
+    MPI_Wait(&requests_[1], MPI_STATUS_IGNORE);
+    return sum_;
+#else
+    if (process_rank_ == 0) {
+        // The root sums its own slice while the other slices and partial sums are in flight
+        if (!requests_.empty())
+            MPI_Startall(static_cast<int>(requests_.size()), requests_.data());
+        part_sum_ = SumKernels::sum<SumKernels::Int64>(part, part_count);
+        if (!requests_.empty())
+            MPI_Waitall(static_cast<int>(requests_.size()), requests_.data(), MPI_STATUSES_IGNORE);
+        sum_ = part_sum_;
+        for (int process_num = 1; process_num < process_count_; process_num++)
+            sum_ += part_sums_[process_num];
+        return sum_;
+    }
+    MPI_Start(&requests_[0]);
+    MPI_Wait(&requests_[0], MPI_STATUS_IGNORE);
+    part_sum_ = SumKernels::sum<SumKernels::Int64>(part, part_count);
+    MPI_Start(&requests_[1]);
+    MPI_Wait(&requests_[1], MPI_STATUS_IGNORE);
+    return 0;
+#endif
+}
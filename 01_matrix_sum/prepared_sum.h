@@ -0,0 +1,43 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Matrix sum prepared for repeated calls with the same size and communicator.
+ *
+ * Counts, displacements and buffers are computed once in the constructor and
+ * the communication is set up as persistent requests: MPI-4 persistent
+ * collectives (MPI_Scatterv_init, MPI_Reduce_init) when available, persistent
+ * point-to-point requests (MPI_Send_init, MPI_Recv_init) otherwise. Every run()
+ * only starts and completes the requests.
+ *
+ * The process 0 writes the matrix into data() before each run(), the buffer is
+ * owned by the object because persistent requests are bound to its address.
+ */
+class PreparedSum {
+public:
+    explicit PreparedSum(int elements_count, MPI_Comm comm = MPI_COMM_WORLD);
+    PreparedSum(const PreparedSum &) = delete;
+    PreparedSum &operator=(const PreparedSum &) = delete;
+    ~PreparedSum();
+
+    // Input buffer of elements_count elements on the process 0, nullptr on the others
+    int *data();
+    // Returns the sum on the process 0
+    int64_t run();
+
+private:
+    MPI_Comm comm_;
+    int process_count_, process_rank_;
+    std::vector<int> counts_, displs_;
+    // The whole matrix on the process 0, the received slice on the others
+    std::vector<int> buffer_;
+    int64_t part_sum_, sum_;
+    std::vector<MPI_Request> requests_;
+#if MPI_VERSION < 4
+    std::vector<int64_t> part_sums_;
+#endif
+};
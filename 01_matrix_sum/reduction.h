@@ -0,0 +1,176 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include "matrix_sum.h"
+#include "mpi_datatype.h"
+
+/**
+ * Generic parallel reduction over vectors of any trivially copyable type.
+ *
+ * An operator is a type with a trivially copyable value_type and three static functions:
+ *     value_type identity();
+ *     void add(value_type* acc, const T& elem, int64_t index);  // folds one element
+ *     void merge(value_type* acc, const value_type& other);      // associative and commutative
+ * Each process folds its slice with add, then the partial results are merged
+ * by MPI_Reduce with an operator registered through MPI_Op_create.
+ *
+ * Several statistics are computed in a single pass over the data by fusing
+ * operators: Reduction::Fuse<MinMax<int>, Welford<int>>.
+ */
+namespace Reduction {
+    template <typename T>
+    struct Sum {
+        using value_type = typename std::conditional<std::is_integral<T>::value, int64_t, double>::type;
+        static value_type identity() {
+            return 0;
+        }
+        static void add(value_type* acc, const T& elem, int64_t) {
+            *acc += elem;
+        }
+        static void merge(value_type* acc, const value_type& other) {
+            *acc += other;
+        }
+    };
+
+    // Largest element and its global index, the first one wins on ties
+    template <typename T>
+    struct ArgMax {
+        struct value_type {
+            T value;
+            int64_t index;
+        };
+        static value_type identity() {
+            return { std::numeric_limits<T>::lowest(), -1 };
+        }
+        static void add(value_type* acc, const T& elem, int64_t index) {
+            if (acc->index < 0 || acc->value < elem)
+                *acc = { elem, index };
+        }
+        static void merge(value_type* acc, const value_type& other) {
+            if (other.index < 0)
+                return;
+            if (acc->index < 0 || acc->value < other.value || (!(other.value < acc->value) && other.index < acc->index))
+                *acc = other;
+        }
+    };
+
+    template <typename T>
+    struct MinMax {
+        struct value_type {
+            T min;
+            T max;
+        };
+        static value_type identity() {
+            return { std::numeric_limits<T>::max(), std::numeric_limits<T>::lowest() };
+        }
+        static void add(value_type* acc, const T& elem, int64_t) {
+            if (elem < acc->min)
+                acc->min = elem;
+            if (acc->max < elem)
+                acc->max = elem;
+        }
+        static void merge(value_type* acc, const value_type& other) {
+            add(acc, other.min, 0);
+            add(acc, other.max, 0);
+        }
+    };
+
+    // Count, mean and variance, partial results are merged with the formula of Chan et al.
+    template <typename T>
+    struct Welford {
+        struct value_type {
+            int64_t count;
+            double mean;
+            double m2;
+            double variance() const {
+                return count > 0 ? m2 / count : 0.;
+            }
+        };
+        static value_type identity() {
+            return { 0, 0., 0. };
+        }
+        static void add(value_type* acc, const T& elem, int64_t) {
+            acc->count++;
+            double delta = static_cast<double>(elem) - acc->mean;
+            acc->mean += delta / acc->count;
+            acc->m2 += delta * (static_cast<double>(elem) - acc->mean);
+        }
+        static void merge(value_type* acc, const value_type& other) {
+            if (other.count == 0)
+                return;
+            int64_t count = acc->count + other.count;
+            double delta = other.mean - acc->mean;
+            acc->mean += delta * other.count / count;
+            acc->m2 += other.m2 + delta * delta * acc->count * other.count / count;
+            acc->count = count;
+        }
+    };
+
+    template <typename First, typename Second>
+    struct Fuse {
+        struct value_type {
+            typename First::value_type first;
+            typename Second::value_type second;
+        };
+        static value_type identity() {
+            return { First::identity(), Second::identity() };
+        }
+        template <typename T>
+        static void add(value_type* acc, const T& elem, int64_t index) {
+            First::add(&acc->first, elem, index);
+            Second::add(&acc->second, elem, index);
+        }
+        static void merge(value_type* acc, const value_type& other) {
+            First::merge(&acc->first, other.first);
+            Second::merge(&acc->second, other.second);
+        }
+    };
+
+    template <typename Op>
+    void mpiOpFunction(void* in, void* inout, int* len, MPI_Datatype*) {
+        auto* other = static_cast<typename Op::value_type*>(in);
+        auto* acc = static_cast<typename Op::value_type*>(inout);
+        for (int i = 0; i < *len; i++)
+            Op::merge(&acc[i], other[i]);
+    }
+
+    // Reduces the vector (read on the process 0 of comm only), the result is returned on the process 0
+    template <typename Op, typename T>
+    typename Op::value_type reduce(const std::vector<T>& vector, int elements_count, MPI_Comm comm = MPI_COMM_WORLD) {
+        using value_type = typename Op::value_type;
+        int process_count, process_rank;
+        MPI_Comm_size(comm, &process_count);
+        MPI_Comm_rank(comm, &process_rank);
+        std::vector<int> counts, displs;
+        calculatePartition(elements_count, process_count, &counts, &displs);
+        int part_count = counts[process_rank];
+        std::vector<T> part_vector;
+        const T* part = nullptr;
+        if (process_rank == 0) {
+            MPI_Scatterv(vector.data(), counts.data(), displs.data(), MpiDatatype<T>::get(), MPI_IN_PLACE, part_count,
+                         MpiDatatype<T>::get(), 0, comm);
+            part = vector.data() + displs[0];
+        } else {
+            part_vector.resize(part_count);
+            MPI_Scatterv(nullptr, nullptr, nullptr, MpiDatatype<T>::get(), part_vector.data(), part_count,
+                         MpiDatatype<T>::get(), 0, comm);
+            part = part_vector.data();
+        }
+
+        value_type part_result = Op::identity();
+        for (int i = 0; i < part_count; i++)
+            Op::add(&part_result, part[i], static_cast<int64_t>(displs[process_rank]) + i);
+
+        MPI_Op mpi_op;
+        MPI_Op_create(&mpiOpFunction<Op>, 1, &mpi_op);
+        value_type result = Op::identity();
+        MPI_Reduce(&part_result, &result, 1, MpiDatatype<value_type>::get(), mpi_op, 0, comm);
+        MPI_Op_free(&mpi_op);
+        return result;
+    }
+}  // namespace Reduction
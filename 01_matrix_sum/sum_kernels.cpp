@@ -0,0 +1,239 @@
+// Copyright 2020 Vlasov Maksim
+#include <stdexcept>
+#include "sum_kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SUM_KERNELS_X86_64
+#include <immintrin.h>
+#endif
+
+// AVX2 code is compiled either through the target attribute (runtime dispatch)
+// or when the whole translation unit is built with AVX2 enabled
+#if defined(SUM_KERNELS_X86_64) && (defined(__GNUC__) || defined(__clang__))
+#define SUM_KERNELS_AVX2
+#define SUM_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(SUM_KERNELS_X86_64) && defined(__AVX2__)
+#define SUM_KERNELS_AVX2
+#define SUM_KERNELS_TARGET_AVX2
+#endif
+
+namespace SumKernels {
+    static int64_t sumInt64Scalar(const int* data, size_t count) {
+        return sumWide(data, count);
+    }
+
+#ifdef SUM_KERNELS_X86_64
+    // SSE2 has no sign extension instruction, so the sign is spread with an
+    // arithmetic shift and interleaved with the values to get 64-bit lanes
+    static int64_t sumInt64SSE2(const int* data, size_t count) {
+        __m128i acc[4] = { _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128() };
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + 4));
+            __m128i first_sign = _mm_srai_epi32(first, 31);
+            __m128i second_sign = _mm_srai_epi32(second, 31);
+            acc[0] = _mm_add_epi64(acc[0], _mm_unpacklo_epi32(first, first_sign));
+            acc[1] = _mm_add_epi64(acc[1], _mm_unpackhi_epi32(first, first_sign));
+            acc[2] = _mm_add_epi64(acc[2], _mm_unpacklo_epi32(second, second_sign));
+            acc[3] = _mm_add_epi64(acc[3], _mm_unpackhi_epi32(second, second_sign));
+        }
+        __m128i total = _mm_add_epi64(_mm_add_epi64(acc[0], acc[1]), _mm_add_epi64(acc[2], acc[3]));
+        int64_t lanes[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), total);
+        return lanes[0] + lanes[1] + sumInt64Scalar(data + i, count - i);
+    }
+#endif
+
+#ifdef SUM_KERNELS_AVX2
+    SUM_KERNELS_TARGET_AVX2 static int64_t sumInt64AVX2(const int* data, size_t count) {
+        __m256i acc[4] = { _mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(),
+                           _mm256_setzero_si256() };
+        size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+            __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 8));
+            acc[0] = _mm256_add_epi64(acc[0], _mm256_cvtepi32_epi64(_mm256_castsi256_si128(first)));
+            acc[1] = _mm256_add_epi64(acc[1], _mm256_cvtepi32_epi64(_mm256_extracti128_si256(first, 1)));
+            acc[2] = _mm256_add_epi64(acc[2], _mm256_cvtepi32_epi64(_mm256_castsi256_si128(second)));
+            acc[3] = _mm256_add_epi64(acc[3], _mm256_cvtepi32_epi64(_mm256_extracti128_si256(second, 1)));
+        }
+        __m256i total = _mm256_add_epi64(_mm256_add_epi64(acc[0], acc[1]), _mm256_add_epi64(acc[2], acc[3]));
+        int64_t lanes[4];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) + sumInt64Scalar(data + i, count - i);
+    }
+#endif
+
+    Isa detectIsa() {
+#if defined(SUM_KERNELS_AVX2) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return Isa::AVX2;
+        return Isa::SSE2;
+#elif defined(SUM_KERNELS_AVX2)
+        return Isa::AVX2;
+#elif defined(SUM_KERNELS_X86_64)
+        return Isa::SSE2;
+#else
+        return Isa::Scalar;
+#endif
+    }
+
+    static int64_t sumInt64Dispatch(const int* data, size_t count, Isa isa) {
+        switch (isa) {
+#ifdef SUM_KERNELS_AVX2
+        case Isa::AVX2:
+            return sumInt64AVX2(data, count);
+#endif
+#ifdef SUM_KERNELS_X86_64
+        case Isa::SSE2:
+            return sumInt64SSE2(data, count);
+#endif
+        default:
+            return sumInt64Scalar(data, count);
+        }
+    }
+
+    int64_t sumInt64(const int* data, size_t count, Isa isa) {
+        if (static_cast<int>(isa) > static_cast<int>(detectIsa()))
+            throw std::runtime_error("Instruction set is not supported");
+        return sumInt64Dispatch(data, count, isa);
+    }
+
+    int64_t sumInt64(const int* data, size_t count) {
+        static const Isa isa = detectIsa();
+        return sumInt64Dispatch(data, count, isa);
+    }
+#ifdef SUM_KERNELS_X86_64
+    // Neumaier step in every lane: the compensation term is chosen with a mask instead of a branch
+    static void neumaierAddSSE2(__m128d* sum, __m128d* compensation, __m128d value) {
+        const __m128d abs_mask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+        __m128d temp = _mm_add_pd(*sum, value);
+        __m128d sum_bigger = _mm_cmpge_pd(_mm_and_pd(*sum, abs_mask), _mm_and_pd(value, abs_mask));
+        __m128d if_sum = _mm_add_pd(_mm_sub_pd(*sum, temp), value);
+        __m128d if_value = _mm_add_pd(_mm_sub_pd(value, temp), *sum);
+        *compensation =
+            _mm_add_pd(*compensation, _mm_or_pd(_mm_and_pd(sum_bigger, if_sum), _mm_andnot_pd(sum_bigger, if_value)));
+        *sum = temp;
+    }
+
+    // Two registers hold the lanes 0-1 and 2-3
+    static double sumCompensatedSSE2(const double* data, size_t count) {
+        __m128d sum[2] = { _mm_setzero_pd(), _mm_setzero_pd() };
+        __m128d compensation[2] = { _mm_setzero_pd(), _mm_setzero_pd() };
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            neumaierAddSSE2(&sum[0], &compensation[0], _mm_loadu_pd(data + i));
+            neumaierAddSSE2(&sum[1], &compensation[1], _mm_loadu_pd(data + i + 2));
+        }
+        double sum_lanes[4], compensation_lanes[4];
+        _mm_storeu_pd(sum_lanes, sum[0]);
+        _mm_storeu_pd(sum_lanes + 2, sum[1]);
+        _mm_storeu_pd(compensation_lanes, compensation[0]);
+        _mm_storeu_pd(compensation_lanes + 2, compensation[1]);
+        return finishCompensated(sum_lanes, compensation_lanes, data + i, count - i);
+    }
+
+    static double pairwiseLeafSSE2(const double* data, size_t count) {
+        __m128d acc[2] = { _mm_setzero_pd(), _mm_setzero_pd() };
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            acc[0] = _mm_add_pd(acc[0], _mm_loadu_pd(data + i));
+            acc[1] = _mm_add_pd(acc[1], _mm_loadu_pd(data + i + 2));
+        }
+        double lanes[4];
+        _mm_storeu_pd(lanes, acc[0]);
+        _mm_storeu_pd(lanes + 2, acc[1]);
+        return finishPairwiseLeaf(lanes, data + i, count - i);
+    }
+#endif
+
+#ifdef SUM_KERNELS_AVX2
+    SUM_KERNELS_TARGET_AVX2 static double sumCompensatedAVX2(const double* data, size_t count) {
+        const __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+        __m256d sum = _mm256_setzero_pd(), compensation = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            __m256d value = _mm256_loadu_pd(data + i);
+            __m256d temp = _mm256_add_pd(sum, value);
+            __m256d sum_bigger =
+                _mm256_cmp_pd(_mm256_and_pd(sum, abs_mask), _mm256_and_pd(value, abs_mask), _CMP_GE_OQ);
+            __m256d if_sum = _mm256_add_pd(_mm256_sub_pd(sum, temp), value);
+            __m256d if_value = _mm256_add_pd(_mm256_sub_pd(value, temp), sum);
+            compensation = _mm256_add_pd(compensation, _mm256_blendv_pd(if_value, if_sum, sum_bigger));
+            sum = temp;
+        }
+        double sum_lanes[4], compensation_lanes[4];
+        _mm256_storeu_pd(sum_lanes, sum);
+        _mm256_storeu_pd(compensation_lanes, compensation);
+        return finishCompensated(sum_lanes, compensation_lanes, data + i, count - i);
+    }
+
+    SUM_KERNELS_TARGET_AVX2 static double pairwiseLeafAVX2(const double* data, size_t count) {
+        __m256d acc = _mm256_setzero_pd();
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+            acc = _mm256_add_pd(acc, _mm256_loadu_pd(data + i));
+        double lanes[4];
+        _mm256_storeu_pd(lanes, acc);
+        return finishPairwiseLeaf(lanes, data + i, count - i);
+    }
+#endif
+
+    static double sumCompensatedDispatch(const double* data, size_t count, Isa isa) {
+        switch (isa) {
+#ifdef SUM_KERNELS_AVX2
+        case Isa::AVX2:
+            return sumCompensatedAVX2(data, count);
+#endif
+#ifdef SUM_KERNELS_X86_64
+        case Isa::SSE2:
+            return sumCompensatedSSE2(data, count);
+#endif
+        default:
+            return sumCompensated(data, count);
+        }
+    }
+
+    static double sumPairwiseDispatch(const double* data, size_t count, Isa isa) {
+        if (count > PAIRWISE_BLOCK_SIZE) {
+            size_t half = count / 2;
+            return sumPairwiseDispatch(data, half, isa) + sumPairwiseDispatch(data + half, count - half, isa);
+        }
+        switch (isa) {
+#ifdef SUM_KERNELS_AVX2
+        case Isa::AVX2:
+            return pairwiseLeafAVX2(data, count);
+#endif
+#ifdef SUM_KERNELS_X86_64
+        case Isa::SSE2:
+            return pairwiseLeafSSE2(data, count);
+#endif
+        default:
+            return sumPairwise(data, count);
+        }
+    }
+
+    double sumCompensatedDouble(const double* data, size_t count, Isa isa) {
+        if (static_cast<int>(isa) > static_cast<int>(detectIsa()))
+            throw std::runtime_error("Instruction set is not supported");
+        return sumCompensatedDispatch(data, count, isa);
+    }
+
+    double sumCompensatedDouble(const double* data, size_t count) {
+        static const Isa isa = detectIsa();
+        return sumCompensatedDispatch(data, count, isa);
+    }
+
+    double sumPairwiseDouble(const double* data, size_t count, Isa isa) {
+        if (static_cast<int>(isa) > static_cast<int>(detectIsa()))
+            throw std::runtime_error("Instruction set is not supported");
+        return sumPairwiseDispatch(data, count, isa);
+    }
+
+    double sumPairwiseDouble(const double* data, size_t count) {
+        static const Isa isa = detectIsa();
+        return sumPairwiseDispatch(data, count, isa);
+    }
+}  // namespace SumKernels
@@ -0,0 +1,160 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Reduction kernels used by the matrix sum.
+ *
+ * Integer data is accumulated into int64_t, so sums of up to 2^32 int elements
+ * can not overflow. The int kernel uses explicit SIMD lanes (SSE2 or AVX2,
+ * selected at runtime) with several independent accumulators in flight.
+ * Floating point data may be summed with compensated (Neumaier) or pairwise
+ * summation, double elements in SSE2 or AVX2 lanes as well.
+ *
+ * The accumulator is selected with a policy type:
+ *     SumKernels::sum<SumKernels::Int64>(data, count)
+ *     SumKernels::sum<SumKernels::Compensated>(data, count)
+ * Every policy also knows the MPI datatype of its result for MPI_Reduce.
+ */
+namespace SumKernels {
+    enum class Isa { Scalar, SSE2, AVX2 };
+
+    // The best instruction set supported by the current CPU
+    Isa detectIsa();
+
+    // Sums int elements into int64_t using the best available instruction set
+    int64_t sumInt64(const int* data, size_t count);
+    // Same as above, but forces the given instruction set (it must not exceed detectIsa())
+    int64_t sumInt64(const int* data, size_t count, Isa isa);
+
+    template <typename T>
+    int64_t sumWide(const T* data, size_t count) {
+        int64_t acc[4] = { 0, 0, 0, 0 };
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            acc[0] += static_cast<int64_t>(data[i]);
+            acc[1] += static_cast<int64_t>(data[i + 1]);
+            acc[2] += static_cast<int64_t>(data[i + 2]);
+            acc[3] += static_cast<int64_t>(data[i + 3]);
+        }
+        for (; i < count; i++)
+            acc[0] += static_cast<int64_t>(data[i]);
+        return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    }
+
+    inline void neumaierAdd(double* sum, double* compensation, double value) {
+        double temp = *sum + value;
+        if ((*sum >= 0 ? *sum : -*sum) >= (value >= 0 ? value : -value))
+            *compensation += (*sum - temp) + value;
+        else
+            *compensation += (value - temp) + *sum;
+        *sum = temp;
+    }
+
+    // Adds the tail to the first lane and combines the four lanes of a compensated sum
+    template <typename T>
+    double finishCompensated(double* sum, double* compensation, const T* tail, size_t count) {
+        for (size_t i = 0; i < count; i++)
+            neumaierAdd(&sum[0], &compensation[0], static_cast<double>(tail[i]));
+        double result = 0., result_compensation = 0.;
+        for (size_t lane = 0; lane < 4; lane++) {
+            neumaierAdd(&result, &result_compensation, sum[lane]);
+            neumaierAdd(&result, &result_compensation, compensation[lane]);
+        }
+        return result + result_compensation;
+    }
+
+    template <typename T>
+    double sumCompensated(const T* data, size_t count) {
+        double sum[4] = { 0., 0., 0., 0. };
+        double compensation[4] = { 0., 0., 0., 0. };
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4)
+            for (size_t lane = 0; lane < 4; lane++)
+                neumaierAdd(&sum[lane], &compensation[lane], static_cast<double>(data[i + lane]));
+        return finishCompensated(sum, compensation, data + i, count - i);
+    }
+
+    const size_t PAIRWISE_BLOCK_SIZE = 128;
+
+    // Adds the tail to the first lane and combines the four lanes of a pairwise leaf
+    template <typename T>
+    double finishPairwiseLeaf(double* acc, const T* tail, size_t count) {
+        for (size_t i = 0; i < count; i++)
+            acc[0] += static_cast<double>(tail[i]);
+        return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+    }
+
+    template <typename T>
+    double sumPairwise(const T* data, size_t count) {
+        if (count <= PAIRWISE_BLOCK_SIZE) {
+            double acc[4] = { 0., 0., 0., 0. };
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4)
+                for (size_t lane = 0; lane < 4; lane++)
+                    acc[lane] += static_cast<double>(data[i + lane]);
+            return finishPairwiseLeaf(acc, data + i, count - i);
+        }
+        size_t half = count / 2;
+        return sumPairwise(data, half) + sumPairwise(data + half, count - half);
+    }
+
+    // Compensated and pairwise sums of double elements using the best available instruction set. The SIMD
+    // lanes get the same elements as the four lanes of the templates above, so every instruction set gives
+    // the same result
+    double sumCompensatedDouble(const double* data, size_t count);
+    double sumPairwiseDouble(const double* data, size_t count);
+    // Same as above, but force the given instruction set (it must not exceed detectIsa())
+    double sumCompensatedDouble(const double* data, size_t count, Isa isa);
+    double sumPairwiseDouble(const double* data, size_t count, Isa isa);
+
+    struct Int64 {
+        using value_type = int64_t;
+        static MPI_Datatype datatype() {
+            return MPI_INT64_T;
+        }
+        static value_type sum(const int* data, size_t count) {
+            return sumInt64(data, count);
+        }
+        template <typename T>
+        static value_type sum(const T* data, size_t count) {
+            return sumWide(data, count);
+        }
+    };
+
+    struct Compensated {
+        using value_type = double;
+        static MPI_Datatype datatype() {
+            return MPI_DOUBLE;
+        }
+        static value_type sum(const double* data, size_t count) {
+            return sumCompensatedDouble(data, count);
+        }
+        template <typename T>
+        static value_type sum(const T* data, size_t count) {
+            return sumCompensated(data, count);
+        }
+    };
+
+    struct Pairwise {
+        using value_type = double;
+        static MPI_Datatype datatype() {
+            return MPI_DOUBLE;
+        }
+        static value_type sum(const double* data, size_t count) {
+            return sumPairwiseDouble(data, count);
+        }
+        template <typename T>
+        static value_type sum(const T* data, size_t count) {
+            return sumPairwise(data, count);
+        }
+    };
+
+    template <typename Accumulator, typename T>
+    typename Accumulator::value_type sum(const T* data, size_t count) {
+        return Accumulator::sum(data, count);
+    }
+}  // namespace SumKernels
@@ -0,0 +1,50 @@
+// Copyright 2020 Vlasov Maksim
+#include <mpi.h>
+#include <vector>
+#include "bcast_aggregator.h"
+#include "broadcast.h"
+
+BcastAggregator::BcastAggregator(int root, MPI_Comm comm, int threshold_bytes)
+    : root_(root), comm_(comm), threshold_bytes_(threshold_bytes), pending_bytes_(0) {}
+
+BcastAggregator::~BcastAggregator() {
+    flush();
+}
+
+void BcastAggregator::enqueue(void* buffer, int count, MPI_Datatype datatype) {
+    if (count == 0)
+        return;
+    MPI_Aint address;
+    MPI_Get_address(buffer, &address);
+    int type_size;
+    MPI_Type_size(datatype, &type_size);
+    MPI_Aint lb, extent;
+    MPI_Type_get_extent(datatype, &lb, &extent);
+    // A buffer which continues the previous one of the same datatype extends its block
+    if (!counts_.empty() && datatypes_.back() == datatype &&
+        addresses_.back() + counts_.back() * extent == address) {
+        counts_.back() += count;
+    } else {
+        counts_.push_back(count);
+        addresses_.push_back(address);
+        datatypes_.push_back(datatype);
+    }
+    pending_bytes_ += count * type_size;
+    if (pending_bytes_ >= threshold_bytes_)
+        flush();
+}
+
+void BcastAggregator::flush() {
+    if (counts_.empty())
+        return;
+    MPI_Datatype batch;
+    MPI_Type_create_struct(static_cast<int>(counts_.size()), counts_.data(), addresses_.data(), datatypes_.data(),
+                           &batch);
+    MPI_Type_commit(&batch);
+    broadcast(MPI_BOTTOM, 1, batch, root_, comm_);
+    MPI_Type_free(&batch);
+    counts_.clear();
+    addresses_.clear();
+    datatypes_.clear();
+    pending_bytes_ = 0;
+}
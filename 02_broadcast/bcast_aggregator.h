@@ -0,0 +1,43 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <vector>
+#include "broadcast.h"
+
+/**
+ * Coalesces many small broadcasts from the same root into one
+ * 
+ * enqueue() only remembers the buffer. flush() describes all queued buffers with
+ * one struct datatype over absolute addresses (MPI_BOTTOM), so they go down the
+ * tree of broadcast() as a single message and are received in place, without
+ * packing. Adjacent buffers of the same datatype are merged into one block of
+ * the datatype. The queue is flushed automatically when it reaches threshold_bytes,
+ * and by the destructor.
+ * 
+ * All processes must enqueue the same sequence of counts and datatypes. The
+ * buffers must stay alive and (on the root) unchanged until they are flushed,
+ * the receivers get the values only after the flush.
+ */
+class BcastAggregator {
+public:
+    explicit BcastAggregator(int root = 0, MPI_Comm comm = MPI_COMM_WORLD,
+                             int threshold_bytes = BROADCAST_SEGMENT_BYTES);
+    BcastAggregator(const BcastAggregator&) = delete;
+    BcastAggregator& operator=(const BcastAggregator&) = delete;
+    ~BcastAggregator();
+
+    void enqueue(void* buffer, int count, MPI_Datatype datatype);
+    void flush();
+
+    int pendingBytes() const { return pending_bytes_; }
+
+private:
+    int root_;
+    MPI_Comm comm_;
+    int threshold_bytes_;
+    int pending_bytes_;
+    std::vector<int> counts_;
+    std::vector<MPI_Aint> addresses_;
+    std::vector<MPI_Datatype> datatypes_;
+};
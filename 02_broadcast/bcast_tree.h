@@ -0,0 +1,65 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <vector>
+
+// Helpers which describe the trees and buffers used by the broadcast and other collective algorithms
+
+inline int choose_rank(int rank, int root) {
+    if (rank == root)
+        return 0;
+    if (rank == 0)
+        return root;
+    return rank;
+}
+
+// Parent of the process in the heap, the ranks are real (not swapped with the root)
+inline int heap_parent(int rank, int root, int fanout) {
+    int v_rank = choose_rank(rank, root);
+    return choose_rank((v_rank - 1) / fanout, root);
+}
+
+// Children of the process in the heap
+inline std::vector<int> heap_children(int rank, int root, int size, int fanout) {
+    int v_rank = choose_rank(rank, root);
+    std::vector<int> children;
+    for (int r_rank = fanout * v_rank + 1; r_rank <= fanout * v_rank + fanout && r_rank < size; r_rank++)
+        children.push_back(choose_rank(r_rank, root));
+    return children;
+}
+
+// Binomial tree and ring algorithms number the processes relative to the root
+inline int relative_rank(int rank, int root, int size) {
+    return (rank - root + size) % size;
+}
+
+inline int real_rank(int r_rank, int root, int size) {
+    return (r_rank + root) % size;
+}
+
+inline char *element_ptr(void *buffer, MPI_Aint extent, int index) {
+    return static_cast<char *>(buffer) + static_cast<MPI_Aint>(index) * extent;
+}
+
+inline MPI_Aint datatype_extent(MPI_Datatype datatype) {
+    MPI_Aint lb, extent;
+    MPI_Type_get_extent(datatype, &lb, &extent);
+    return extent;
+}
+
+// Copies data between buffers of the process, the layouts may differ if the type signatures match
+inline void copy_local(const void *from, int from_count, MPI_Datatype from_type, void *to, int to_count,
+                       MPI_Datatype to_type) {
+    MPI_Sendrecv(from, from_count, from_type, 0, 0, to, to_count, to_type, 0, 0, MPI_COMM_SELF, MPI_STATUS_IGNORE);
+}
+
+// Temporary buffer for count elements of the datatype, returns the address to pass to MPI
+inline char *allocate_buffer(int count, MPI_Datatype datatype, std::vector<char> *storage) {
+    MPI_Aint lb, extent, true_lb, true_extent;
+    MPI_Type_get_extent(datatype, &lb, &extent);
+    MPI_Type_get_true_extent(datatype, &true_lb, &true_extent);
+    MPI_Aint bytes = count > 0 ? true_extent + static_cast<MPI_Aint>(count - 1) * extent : 0;
+    storage->resize(static_cast<size_t>(bytes > 0 ? bytes : 1));
+    return storage->data() - true_lb;
+}
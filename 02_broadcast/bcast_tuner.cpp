@@ -0,0 +1,165 @@
+// Copyright 2020 Vlasov Maksim
+#include <mpi.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+#include "bcast_tuner.h"
+#include "broadcast.h"
+
+static const BcastAlgorithm ALGORITHMS[] = { BcastAlgorithm::BinaryHeap, BcastAlgorithm::Segmented,
+                                             BcastAlgorithm::Binomial,   BcastAlgorithm::KAry,
+                                             BcastAlgorithm::Chain,      BcastAlgorithm::ScatterAllgather };
+
+const char* bcastAlgorithmName(BcastAlgorithm algorithm) {
+    switch (algorithm) {
+    case BcastAlgorithm::BinaryHeap:
+        return "binary_heap";
+    case BcastAlgorithm::Segmented:
+        return "segmented";
+    case BcastAlgorithm::Binomial:
+        return "binomial";
+    case BcastAlgorithm::KAry:
+        return "k_ary";
+    case BcastAlgorithm::Chain:
+        return "chain";
+    case BcastAlgorithm::ScatterAllgather:
+        return "scatter_allgather";
+    }
+    return "unknown";
+}
+
+void BcastTuner::tune(MPI_Comm comm, int max_bytes, int iterations) {
+    int size;
+    MPI_Comm_size(comm, &size);
+    crossovers_.erase(std::remove_if(crossovers_.begin(), crossovers_.end(),
+                                     [size](const Crossover& crossover) { return crossover.comm_size == size; }),
+                      crossovers_.end());
+    std::vector<Crossover> tuned;
+    std::vector<char> buffer(std::max(1, max_bytes));
+    for (int bytes = 1;; bytes = std::min(bytes * 4, max_bytes)) {
+        BcastAlgorithm best = BcastAlgorithm::BinaryHeap;
+        double best_time = std::numeric_limits<double>::max();
+        for (BcastAlgorithm algorithm : ALGORITHMS) {
+            // Warm-up call
+            broadcast(buffer.data(), bytes, MPI_BYTE, 0, comm, algorithm);
+            MPI_Barrier(comm);
+            double t1 = MPI_Wtime();
+            for (int i = 0; i < iterations; i++)
+                broadcast(buffer.data(), bytes, MPI_BYTE, 0, comm, algorithm);
+            double time = MPI_Wtime() - t1, max_time;
+            MPI_Allreduce(&time, &max_time, 1, MPI_DOUBLE, MPI_MAX, comm);
+            if (max_time < best_time) {
+                best_time = max_time;
+                best = algorithm;
+            }
+        }
+        if (tuned.empty() || tuned.back().algorithm != best)
+            tuned.push_back({ size, bytes, best });
+        if (bytes >= max_bytes)
+            break;
+    }
+    crossovers_.insert(crossovers_.end(), tuned.begin(), tuned.end());
+    std::stable_sort(crossovers_.begin(), crossovers_.end(), [](const Crossover& lhs, const Crossover& rhs) {
+        return lhs.comm_size < rhs.comm_size || (lhs.comm_size == rhs.comm_size && lhs.bytes < rhs.bytes);
+    });
+}
+
+bool BcastTuner::save(const std::string& file_name) const {
+    std::ofstream file(file_name);
+    if (!file)
+        return false;
+    file << "# comm_size bytes algorithm\n";
+    for (const Crossover& crossover : crossovers_)
+        file << crossover.comm_size << ' ' << crossover.bytes << ' ' << bcastAlgorithmName(crossover.algorithm)
+             << '\n';
+    return static_cast<bool>(file);
+}
+
+bool BcastTuner::load(const std::string& file_name, MPI_Comm comm) {
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    // Flattened table: comm_size, bytes, algorithm for every crossover; a negative size means an error
+    std::vector<int> table;
+    int table_size = -1;
+    if (rank == 0) {
+        std::ifstream file(file_name);
+        if (file) {
+            // A malformed line or an unknown algorithm rejects the whole file rather than truncating the table
+            bool valid = true;
+            std::string line;
+            while (valid && std::getline(file, line)) {
+                if (line.empty() || line[0] == '#')
+                    continue;
+                char name[64];
+                int comm_size, bytes;
+                valid = std::sscanf(line.c_str(), "%d %d %63s", &comm_size, &bytes, name) == 3;
+                if (!valid)
+                    break;
+                valid = false;
+                for (BcastAlgorithm algorithm : ALGORITHMS) {
+                    if (name == std::string(bcastAlgorithmName(algorithm))) {
+                        table.push_back(comm_size);
+                        table.push_back(bytes);
+                        table.push_back(static_cast<int>(algorithm));
+                        valid = true;
+                    }
+                }
+            }
+            if (valid)
+                table_size = static_cast<int>(table.size());
+        }
+    }
+    broadcast(&table_size, 1, MPI_INT, 0, comm);
+    if (table_size < 0)
+        return false;
+    table.resize(table_size);
+    broadcast(table.data(), table_size, MPI_INT, 0, comm);
+    crossovers_.clear();
+    for (int i = 0; i + 2 < table_size; i += 3)
+        crossovers_.push_back({ table[i], table[i + 1], static_cast<BcastAlgorithm>(table[i + 2]) });
+    std::stable_sort(crossovers_.begin(), crossovers_.end(), [](const Crossover& lhs, const Crossover& rhs) {
+        return lhs.comm_size < rhs.comm_size || (lhs.comm_size == rhs.comm_size && lhs.bytes < rhs.bytes);
+    });
+    return true;
+}
+
+BcastAlgorithm BcastTuner::select(int bytes, int comm_size) const {
+    if (crossovers_.empty()) {
+        if (comm_size <= 2 || bytes <= 8192)
+            return BcastAlgorithm::Binomial;
+        if (bytes >= 524288)
+            return BcastAlgorithm::ScatterAllgather;
+        return BcastAlgorithm::Segmented;
+    }
+    int tuned_size = crossovers_.front().comm_size;
+    for (const Crossover& crossover : crossovers_)
+        if (std::abs(crossover.comm_size - comm_size) < std::abs(tuned_size - comm_size))
+            tuned_size = crossover.comm_size;
+    BcastAlgorithm result = BcastAlgorithm::BinaryHeap;
+    bool found = false;
+    for (const Crossover& crossover : crossovers_) {
+        if (crossover.comm_size != tuned_size)
+            continue;
+        if (!found || crossover.bytes <= bytes)
+            result = crossover.algorithm;
+        found = true;
+    }
+    return result;
+}
+
+BcastTuner& bcastTuner() {
+    static BcastTuner tuner;
+    return tuner;
+}
+
+int broadcastTuned(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm) {
+    int size, type_size;
+    MPI_Comm_size(comm, &size);
+    MPI_Type_size(datatype, &type_size);
+    BcastAlgorithm algorithm = bcastTuner().select(count * type_size, size);
+    return broadcast(buffer, count, datatype, root, comm, algorithm);
+}
@@ -0,0 +1,50 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <string>
+#include <vector>
+#include "broadcast.h"
+
+const char* bcastAlgorithmName(BcastAlgorithm algorithm);
+
+/**
+ * Chooses a broadcast algorithm by message size and communicator size
+ * 
+ * tune() benchmarks every algorithm on the given communicator for messages
+ * from 1 byte up to max_bytes (multiplying the size by 4) and keeps the
+ * crossover points: the message sizes from which another algorithm becomes the
+ * fastest one. Timings are reduced with MPI_MAX, so all processes make the same
+ * choice. The table may be saved to a local text file and loaded at startup
+ * instead of tuning again.
+ * 
+ * Communicator sizes which were not tuned use the closest tuned size, and
+ * without any tuning data a simple heuristic is used.
+ */
+class BcastTuner {
+public:
+    // Collective over comm
+    void tune(MPI_Comm comm, int max_bytes = 1 << 22, int iterations = 10);
+    // Writes the table on the calling process, returns false if the file can not be written
+    bool save(const std::string& file_name) const;
+    // Collective over comm: the process 0 reads the file and broadcasts the table.
+    // Returns false on all processes if the file can not be read.
+    bool load(const std::string& file_name, MPI_Comm comm);
+
+    BcastAlgorithm select(int bytes, int comm_size) const;
+
+private:
+    struct Crossover {
+        int comm_size;
+        int bytes;
+        BcastAlgorithm algorithm;
+    };
+    // Sorted by communicator size, then by message size
+    std::vector<Crossover> crossovers_;
+};
+
+// Tuner used by broadcastTuned
+BcastTuner& bcastTuner();
+
+// Broadcast with the algorithm chosen by bcastTuner() for this message and communicator size
+int broadcastTuned(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm);
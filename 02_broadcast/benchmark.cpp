@@ -0,0 +1,356 @@
+// Copyright 2020 Vlasov Maksim
+#include <mpi.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bcast_tuner.h"
+#include "broadcast.h"
+#include "collectives.h"
+#include "hierarchical_broadcast.h"
+
+/**
+ * OSU-style latency and bandwidth benchmark of the custom collectives and
+ * their vendor equivalents
+ *
+ * For every communicator size (the first processes of MPI_COMM_WORLD), every
+ * collective and every message size from --min-bytes to --max-bytes (doubling)
+ * the collective is called --warmup times, then --iterations times, each call
+ * separated by a barrier which is not timed. The per-call latency is reduced
+ * over the processes to min/avg/max, and the bandwidth is the message size over
+ * the average latency. The message size is the whole buffer of the root: for
+ * gather and scatter every process contributes bytes / comm_size.
+ *
+ * Example:
+ *     mpirun --oversubscribe -np 8 broadcast_benchmark --max-bytes 1M --format json
+ */
+namespace Benchmark {
+    struct Options {
+        int min_bytes = 1;
+        int max_bytes = 64 << 20;
+        int iterations = 100;
+        int warmup = 10;
+        // Messages above this size run large_iterations and large_warmup times
+        int large_bytes = 1 << 20;
+        int large_iterations = 10;
+        int large_warmup = 2;
+        std::vector<int> comm_sizes;
+        std::vector<std::string> collectives;
+        std::string format = "csv";
+        std::string output;
+    };
+
+    struct Context {
+        MPI_Comm comm;
+        int size;
+        // Elements per call, per process for gather and scatter
+        int count;
+        std::vector<char> send, recv;
+        std::unique_ptr<HierarchicalBroadcast> hierarchical;
+    };
+
+    struct Collective {
+        const char* name;
+        // Size of an element in bytes
+        int unit;
+        // The message is split between the processes
+        bool per_process;
+        void (*run)(Context* context);
+    };
+
+    struct Result {
+        std::string collective;
+        int comm_size;
+        int64_t bytes;
+        int iterations;
+        double min_latency, avg_latency, max_latency, bandwidth;
+    };
+
+    const Collective COLLECTIVES[] = {
+        { "bcast_heap", 1, false,
+          [](Context* c) { broadcast(c->send.data(), c->count, MPI_BYTE, 0, c->comm); } },
+        { "bcast_kary", 1, false,
+          [](Context* c) {
+              broadcastKAry(c->send.data(), c->count, MPI_BYTE, 0, c->comm, BROADCAST_DEFAULT_FANOUT);
+          } },
+        { "bcast_binomial", 1, false,
+          [](Context* c) { broadcastBinomial(c->send.data(), c->count, MPI_BYTE, 0, c->comm); } },
+        { "bcast_segmented", 1, false,
+          [](Context* c) { broadcastSegmented(c->send.data(), c->count, MPI_BYTE, 0, c->comm); } },
+        { "bcast_chain", 1, false,
+          [](Context* c) { broadcastChain(c->send.data(), c->count, MPI_BYTE, 0, c->comm); } },
+        { "bcast_scatter_allgather", 1, false,
+          [](Context* c) { broadcastScatterAllgather(c->send.data(), c->count, MPI_BYTE, 0, c->comm); } },
+        { "bcast_tuned", 1, false,
+          [](Context* c) { broadcastTuned(c->send.data(), c->count, MPI_BYTE, 0, c->comm); } },
+        { "bcast_hierarchical", 1, false,
+          [](Context* c) { c->hierarchical->broadcast(c->send.data(), c->count, MPI_BYTE, 0); } },
+        { "bcast_vendor", 1, false,
+          [](Context* c) { MPI_Bcast(c->send.data(), c->count, MPI_BYTE, 0, c->comm); } },
+        { "reduce", 4, false,
+          [](Context* c) {
+              reduce(c->send.data(), c->recv.data(), c->count, MPI_INT, MPI_SUM, 0, c->comm);
+          } },
+        { "reduce_vendor", 4, false,
+          [](Context* c) {
+              MPI_Reduce(c->send.data(), c->recv.data(), c->count, MPI_INT, MPI_SUM, 0, c->comm);
+          } },
+        { "allreduce", 4, false,
+          [](Context* c) {
+              allreduce(c->send.data(), c->recv.data(), c->count, MPI_INT, MPI_SUM, c->comm);
+          } },
+        { "allreduce_vendor", 4, false,
+          [](Context* c) {
+              MPI_Allreduce(c->send.data(), c->recv.data(), c->count, MPI_INT, MPI_SUM, c->comm);
+          } },
+        { "gather", 1, true,
+          [](Context* c) {
+              gather(c->send.data(), c->count, MPI_BYTE, c->recv.data(), c->count, MPI_BYTE, 0, c->comm);
+          } },
+        { "gather_vendor", 1, true,
+          [](Context* c) {
+              MPI_Gather(c->send.data(), c->count, MPI_BYTE, c->recv.data(), c->count, MPI_BYTE, 0, c->comm);
+          } },
+        { "scatter", 1, true,
+          [](Context* c) {
+              scatter(c->send.data(), c->count, MPI_BYTE, c->recv.data(), c->count, MPI_BYTE, 0, c->comm);
+          } },
+        { "scatter_vendor", 1, true,
+          [](Context* c) {
+              MPI_Scatter(c->send.data(), c->count, MPI_BYTE, c->recv.data(), c->count, MPI_BYTE, 0, c->comm);
+          } },
+    };
+
+    void printUsage(std::ostream& out) {
+        out << "Usage: broadcast_benchmark [options]\n"
+               "  --min-bytes N           smallest message size (default 1)\n"
+               "  --max-bytes N           largest message size (default 64M)\n"
+               "  --iterations N          timed calls per message size (default 100)\n"
+               "  --warmup N              untimed calls per message size (default 10)\n"
+               "  --large-bytes N         messages above N bytes use the large counts (default 1M)\n"
+               "  --large-iterations N    (default 10)\n"
+               "  --large-warmup N        (default 2)\n"
+               "  --comm-sizes A,B,...    communicator sizes (default powers of two and the world size)\n"
+               "  --collectives A,B,...   collectives to run (default all)\n"
+               "  --format csv|json       output format (default csv)\n"
+               "  --output FILE           write the results to FILE instead of stdout\n"
+               "Sizes accept K, M and G suffixes. Collectives:";
+        for (const Collective& collective : COLLECTIVES)
+            out << ' ' << collective.name;
+        out << std::endl;
+    }
+
+    int parseSize(const std::string& value) {
+        size_t end;
+        long long size = std::stoll(value, &end);
+        std::string suffix = value.substr(end);
+        if (suffix == "K" || suffix == "k")
+            size <<= 10;
+        else if (suffix == "M" || suffix == "m")
+            size <<= 20;
+        else if (suffix == "G" || suffix == "g")
+            size <<= 30;
+        else if (!suffix.empty())
+            throw std::runtime_error("Invalid size: " + value);
+        if (size < 0 || size > (1LL << 30))
+            throw std::runtime_error("Size is out of range: " + value);
+        return static_cast<int>(size);
+    }
+
+    std::vector<std::string> split(const std::string& value) {
+        std::vector<std::string> items;
+        std::istringstream stream(value);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            if (!item.empty())
+                items.push_back(item);
+        return items;
+    }
+
+    Options parseOptions(int argc, char* argv[], int world_size) {
+        Options options;
+        for (int i = 1; i < argc; i++) {
+            std::string name = argv[i];
+            if (name == "--help")
+                throw std::runtime_error("");
+            if (i + 1 >= argc)
+                throw std::runtime_error("Missing value of " + name);
+            std::string value = argv[++i];
+            if (name == "--min-bytes")
+                options.min_bytes = parseSize(value);
+            else if (name == "--max-bytes")
+                options.max_bytes = parseSize(value);
+            else if (name == "--iterations")
+                options.iterations = parseSize(value);
+            else if (name == "--warmup")
+                options.warmup = parseSize(value);
+            else if (name == "--large-bytes")
+                options.large_bytes = parseSize(value);
+            else if (name == "--large-iterations")
+                options.large_iterations = parseSize(value);
+            else if (name == "--large-warmup")
+                options.large_warmup = parseSize(value);
+            else if (name == "--comm-sizes")
+                for (const std::string& size : split(value))
+                    options.comm_sizes.push_back(parseSize(size));
+            else if (name == "--collectives")
+                options.collectives = split(value);
+            else if (name == "--format")
+                options.format = value;
+            else if (name == "--output")
+                options.output = value;
+            else
+                throw std::runtime_error("Unknown option " + name);
+        }
+        if (options.min_bytes < 1 || options.min_bytes > options.max_bytes)
+            throw std::runtime_error("Invalid range of message sizes");
+        if (options.iterations < 1 || options.large_iterations < 1)
+            throw std::runtime_error("Iterations count must be positive");
+        if (options.format != "csv" && options.format != "json")
+            throw std::runtime_error("Unknown format " + options.format);
+        if (options.comm_sizes.empty()) {
+            for (int size = 2; size < world_size; size *= 2)
+                options.comm_sizes.push_back(size);
+            options.comm_sizes.push_back(world_size);
+        }
+        for (int size : options.comm_sizes)
+            if (size < 1 || size > world_size)
+                throw std::runtime_error("Communicator size " + std::to_string(size) + " is out of range");
+        if (options.collectives.empty())
+            for (const Collective& collective : COLLECTIVES)
+                options.collectives.push_back(collective.name);
+        for (const std::string& name : options.collectives)
+            if (std::none_of(std::begin(COLLECTIVES), std::end(COLLECTIVES),
+                             [&name](const Collective& collective) { return name == collective.name; }))
+                throw std::runtime_error("Unknown collective " + name);
+        return options;
+    }
+
+    // Collective over context->comm, the result is meaningful on its process 0
+    Result measure(const Collective& collective, int bytes, const Options& options, Context* context) {
+        int per_process = collective.per_process ? bytes / context->size : bytes;
+        context->count = per_process / collective.unit;
+        bool large = bytes > options.large_bytes;
+        int iterations = large ? options.large_iterations : options.iterations;
+        int warmup = large ? options.large_warmup : options.warmup;
+        for (int i = 0; i < warmup; i++)
+            collective.run(context);
+        double latency = 0.;
+        for (int i = 0; i < iterations; i++) {
+            MPI_Barrier(context->comm);
+            double t1 = MPI_Wtime();
+            collective.run(context);
+            latency += MPI_Wtime() - t1;
+        }
+        latency = latency / iterations * 1e6;
+
+        Result result;
+        result.collective = collective.name;
+        result.comm_size = context->size;
+        result.bytes = static_cast<int64_t>(context->count) * collective.unit *
+                       (collective.per_process ? context->size : 1);
+        result.iterations = iterations;
+        double sum_latency;
+        MPI_Reduce(&latency, &result.min_latency, 1, MPI_DOUBLE, MPI_MIN, 0, context->comm);
+        MPI_Reduce(&latency, &result.max_latency, 1, MPI_DOUBLE, MPI_MAX, 0, context->comm);
+        MPI_Reduce(&latency, &sum_latency, 1, MPI_DOUBLE, MPI_SUM, 0, context->comm);
+        result.avg_latency = sum_latency / context->size;
+        // Bytes per microsecond are megabytes (10^6) per second
+        result.bandwidth = result.bytes / result.avg_latency;
+        return result;
+    }
+
+    void write(const std::vector<Result>& results, const std::string& format, std::ostream& out) {
+        if (format == "csv") {
+            out << "collective,comm_size,bytes,iterations,min_latency_us,avg_latency_us,max_latency_us,"
+                   "bandwidth_mb_s\n";
+            for (const Result& result : results)
+                out << result.collective << ',' << result.comm_size << ',' << result.bytes << ','
+                    << result.iterations << ',' << result.min_latency << ',' << result.avg_latency << ','
+                    << result.max_latency << ',' << result.bandwidth << '\n';
+        } else {
+            out << "[\n";
+            for (size_t i = 0; i < results.size(); i++) {
+                const Result& result = results[i];
+                out << "  {\"collective\": \"" << result.collective << "\", \"comm_size\": " << result.comm_size
+                    << ", \"bytes\": " << result.bytes << ", \"iterations\": " << result.iterations
+                    << ", \"min_latency_us\": " << result.min_latency
+                    << ", \"avg_latency_us\": " << result.avg_latency
+                    << ", \"max_latency_us\": " << result.max_latency
+                    << ", \"bandwidth_mb_s\": " << result.bandwidth << "}" << (i + 1 < results.size() ? "," : "")
+                    << "\n";
+            }
+            out << "]\n";
+        }
+        out.flush();
+    }
+}  // namespace Benchmark
+
+int main(int argc, char* argv[]) {
+    MPI_Init(&argc, &argv);
+    int world_rank, world_size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    Benchmark::Options options;
+    try {
+        options = Benchmark::parseOptions(argc, argv, world_size);
+    } catch (const std::exception& error) {
+        if (world_rank == 0) {
+            if (error.what()[0] != '\0')
+                std::cerr << error.what() << std::endl;
+            Benchmark::printUsage(std::cerr);
+        }
+        MPI_Finalize();
+        return 1;
+    }
+
+    std::vector<Benchmark::Result> results;
+    for (int comm_size : options.comm_sizes) {
+        Benchmark::Context context;
+        MPI_Comm_split(MPI_COMM_WORLD, world_rank < comm_size ? 0 : MPI_UNDEFINED, world_rank, &context.comm);
+        if (context.comm != MPI_COMM_NULL) {
+            context.size = comm_size;
+            context.send.assign(options.max_bytes, 1);
+            context.recv.resize(options.max_bytes);
+            if (std::count(options.collectives.begin(), options.collectives.end(), "bcast_hierarchical") > 0)
+                context.hierarchical.reset(new HierarchicalBroadcast(context.comm));
+            for (const std::string& name : options.collectives) {
+                const Benchmark::Collective& collective =
+                    *std::find_if(std::begin(Benchmark::COLLECTIVES), std::end(Benchmark::COLLECTIVES),
+                                  [&name](const Benchmark::Collective& c) { return name == c.name; });
+                for (int64_t bytes = options.min_bytes; bytes <= options.max_bytes; bytes *= 2) {
+                    int per_process = collective.per_process ? static_cast<int>(bytes) / comm_size
+                                                             : static_cast<int>(bytes);
+                    if (per_process < collective.unit)
+                        continue;
+                    Benchmark::Result result =
+                        Benchmark::measure(collective, static_cast<int>(bytes), options, &context);
+                    if (world_rank == 0)
+                        results.push_back(result);
+                }
+            }
+            context.hierarchical.reset();
+            MPI_Comm_free(&context.comm);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    if (world_rank == 0) {
+        if (options.output.empty()) {
+            Benchmark::write(results, options.format, std::cout);
+        } else {
+            std::ofstream file(options.output);
+            Benchmark::write(results, options.format, file);
+        }
+    }
+    MPI_Finalize();
+    return 0;
+}
@@ -1,31 +1,166 @@
 // Copyright 2020 Vlasov Maksim
 #include <mpi.h>
+#include <algorithm>
+#include <vector>
 #include "broadcast.h"
+#include "bcast_tree.h"
 
-inline int choose_rank(int rank, int root) {
-    if (rank == root)
-        return 0;
-    if (rank == 0)
-        return root;
-    return rank;
+static int choose_segment_size(MPI_Aint extent, int segment_size) {
+    if (segment_size > 0)
+        return segment_size;
+    return static_cast<int>(std::max<MPI_Aint>(1, BROADCAST_SEGMENT_BYTES / std::max<MPI_Aint>(1, extent)));
+}
+
+// Streams the buffer from parent to children segment by segment
+static int pipeline(void *buffer, int count, MPI_Datatype datatype, MPI_Comm comm, int parent,
+                    const std::vector<int> &children, int segment_size) {
+    MPI_Aint extent = datatype_extent(datatype);
+    segment_size = choose_segment_size(extent, segment_size);
+    int segments_count = (count + segment_size - 1) / segment_size;
+    // Segment i is forwarded with non-blocking sends, so the next segment is
+    // received from the parent while the children are still receiving this one
+    std::vector<MPI_Request> requests;
+    requests.reserve(children.size() * segments_count);
+    for (int segment = 0; segment < segments_count; segment++) {
+        char *segment_buffer = element_ptr(buffer, extent, segment * segment_size);
+        int segment_count = std::min(segment_size, count - segment * segment_size);
+        if (parent != MPI_PROC_NULL)
+            MPI_Recv(segment_buffer, segment_count, datatype, parent, 0, comm, MPI_STATUS_IGNORE);
+        for (int child : children) {
+            requests.emplace_back();
+            MPI_Isend(segment_buffer, segment_count, datatype, child, 0, comm, &requests.back());
+        }
+    }
+    if (!requests.empty())
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+    return MPI_SUCCESS;
 }
 
 int broadcast(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm) {
+    return broadcastKAry(buffer, count, datatype, root, comm, 2);
+}
+
+int broadcastKAry(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm, int fanout) {
     int rank, size;
     MPI_Comm_rank(comm, &rank);
     MPI_Comm_size(comm, &size);
+    if (fanout < 1)
+        return MPI_ERR_ARG;
     if (rank != root) {
         MPI_Status status;
-        int s_rank = (rank % 2 != 0) ? (rank - 1) / 2 : (rank - 2) / 2;
-        MPI_Recv(buffer, count, datatype, choose_rank(s_rank, root), 0, comm, &status);
-    }
-    int r_rank_1 = 2 * rank + 1;
-    int r_rank_2 = 2 * rank + 2;
-    if (r_rank_1 < size) {
-        MPI_Send(buffer, count, datatype, choose_rank(r_rank_1, root), 0, comm);
-        if (r_rank_2 < size) {
-            MPI_Send(buffer, count, datatype, choose_rank(r_rank_2, root), 0, comm);
+        MPI_Recv(buffer, count, datatype, heap_parent(rank, root, fanout), 0, comm, &status);
+    }
+    std::vector<int> children = heap_children(rank, root, size, fanout);
+    std::vector<MPI_Request> requests(children.size());
+    for (size_t i = 0; i < children.size(); i++)
+        MPI_Isend(buffer, count, datatype, children[i], 0, comm, &requests[i]);
+    if (!requests.empty())
+        MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+    return MPI_SUCCESS;
+}
+
+int broadcastSegmented(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm, int segment_size) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    int parent = rank != root ? heap_parent(rank, root, 2) : MPI_PROC_NULL;
+    return pipeline(buffer, count, datatype, comm, parent, heap_children(rank, root, size, 2), segment_size);
+}
+
+int broadcastChain(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm, int segment_size) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    int r_rank = relative_rank(rank, root, size);
+    int parent = r_rank > 0 ? real_rank(r_rank - 1, root, size) : MPI_PROC_NULL;
+    std::vector<int> children;
+    if (r_rank + 1 < size)
+        children.push_back(real_rank(r_rank + 1, root, size));
+    return pipeline(buffer, count, datatype, comm, parent, children, segment_size);
+}
+
+int broadcastBinomial(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    int r_rank = relative_rank(rank, root, size);
+    // The process receives from the one which differs in the lowest set bit of the relative rank
+    int mask = 1;
+    for (; mask < size; mask <<= 1) {
+        if (r_rank & mask) {
+            MPI_Recv(buffer, count, datatype, real_rank(r_rank - mask, root, size), 0, comm, MPI_STATUS_IGNORE);
+            break;
+        }
+    }
+    for (mask >>= 1; mask > 0; mask >>= 1)
+        if (r_rank + mask < size)
+            MPI_Send(buffer, count, datatype, real_rank(r_rank + mask, root, size), 0, comm);
+    return MPI_SUCCESS;
+}
+
+int broadcastScatterAllgather(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    if (count < size)
+        return broadcastBinomial(buffer, count, datatype, root, comm);
+    MPI_Aint extent = datatype_extent(datatype);
+    // Block i (in relative ranks) is [displs[i], displs[i] + counts[i])
+    std::vector<int> counts(size), displs(size);
+    for (int i = 0, displ = 0; i < size; i++) {
+        counts[i] = count / size + (i < count % size ? 1 : 0);
+        displs[i] = displ;
+        displ += counts[i];
+    }
+    auto blocks_count = [&](int first, int last) {
+        last = std::min(last, size);
+        return displs[last - 1] + counts[last - 1] - displs[first];
+    };
+
+    // Binomial scatter: the subtree of relative rank r covers the blocks [r, r + mask)
+    int r_rank = relative_rank(rank, root, size);
+    int mask = 1;
+    for (; mask < size; mask <<= 1) {
+        if (r_rank & mask) {
+            MPI_Recv(element_ptr(buffer, extent, displs[r_rank]), blocks_count(r_rank, r_rank + mask), datatype,
+                     real_rank(r_rank - mask, root, size), 0, comm, MPI_STATUS_IGNORE);
+            break;
         }
     }
+    for (mask >>= 1; mask > 0; mask >>= 1) {
+        int child = r_rank + mask;
+        if (child < size)
+            MPI_Send(element_ptr(buffer, extent, displs[child]), blocks_count(child, child + mask), datatype,
+                     real_rank(child, root, size), 0, comm);
+    }
+
+    // Ring allgather: at step s every process passes the block it got at step s - 1 to the right
+    int left = real_rank((r_rank - 1 + size) % size, root, size);
+    int right = real_rank((r_rank + 1) % size, root, size);
+    for (int step = 0; step < size - 1; step++) {
+        int send_block = (r_rank - step + size) % size;
+        int recv_block = (r_rank - step - 1 + size) % size;
+        MPI_Sendrecv(element_ptr(buffer, extent, displs[send_block]), counts[send_block], datatype, right, 1,
+                     element_ptr(buffer, extent, displs[recv_block]), counts[recv_block], datatype, left, 1, comm,
+                     MPI_STATUS_IGNORE);
+    }
     return MPI_SUCCESS;
 }
+
+int broadcast(void *buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm, BcastAlgorithm algorithm) {
+    switch (algorithm) {
+    case BcastAlgorithm::BinaryHeap:
+        return broadcast(buffer, count, datatype, root, comm);
+    case BcastAlgorithm::Segmented:
+        return broadcastSegmented(buffer, count, datatype, root, comm);
+    case BcastAlgorithm::Binomial:
+        return broadcastBinomial(buffer, count, datatype, root, comm);
+    case BcastAlgorithm::KAry:
+        return broadcastKAry(buffer, count, datatype, root, comm, BROADCAST_DEFAULT_FANOUT);
+    case BcastAlgorithm::Chain:
+        return broadcastChain(buffer, count, datatype, root, comm);
+    case BcastAlgorithm::ScatterAllgather:
+        return broadcastScatterAllgather(buffer, count, datatype, root, comm);
+    }
+    return MPI_ERR_ARG;
+}
@@ -1,6 +1,8 @@
 // Copyright 2020 Vlasov Maksim
 #pragma once
 
+#include <mpi.h>
+
 /**
  * Performs the same action as MPI_Bcast does
  * 
@@ -17,3 +19,60 @@
  * with ranks 2x+1 and 2x+2 if possible.
  */
 int broadcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm);
+
+// Default segment size of the pipelined algorithms in bytes
+constexpr int BROADCAST_SEGMENT_BYTES = 65536;
+
+// Fanout of the k-ary heap when it is chosen by BcastAlgorithm
+constexpr int BROADCAST_DEFAULT_FANOUT = 4;
+
+/**
+ * Segmented (pipelined) version of broadcast for large messages
+ * 
+ * The same heap is used, but the buffer is split into segments of segment_size
+ * elements which are streamed down the tree: a process forwards segment i to its
+ * children while it receives segment i+1 from its parent, so the latency is
+ * about message size + tree depth * segment size instead of message size * tree depth.
+ * 
+ * If segment_size is not positive, it is chosen from the datatype extent so that
+ * a segment takes about BROADCAST_SEGMENT_BYTES bytes.
+ */
+int broadcastSegmented(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm,
+                       int segment_size = 0);
+
+/**
+ * Generalization of broadcast to a k-ary heap: the process with (swapped) rank x
+ * receives data from (x-1)/k and sends it to kx+1, ..., kx+k.
+ * 
+ * Sends to all children are posted at once with MPI_Isend, so the transfers to
+ * the children overlap instead of going one after another.
+ */
+int broadcastKAry(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm, int fanout);
+
+/**
+ * Binomial tree: processes are numbered relative to the root, the process x
+ * receives data from x without its lowest set bit and sends it to x+2^j for
+ * every 2^j below that bit. It takes ceil(log2(size)) rounds.
+ */
+int broadcastBinomial(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm);
+
+/**
+ * Chain pipeline: processes form a chain starting from the root, the buffer is
+ * streamed along it in segments (see broadcastSegmented). Suits very large
+ * messages when every process should send and receive exactly once per segment.
+ */
+int broadcastChain(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm, int segment_size = 0);
+
+/**
+ * Scatter + ring allgather (van de Geijn): the buffer is split into size blocks,
+ * which are scattered with a binomial tree and then collected by every process
+ * in size-1 ring steps. Each process sends about 2 * count elements in total
+ * regardless of the number of processes, so it suits large payloads.
+ * Falls back to broadcastBinomial if count < size.
+ */
+int broadcastScatterAllgather(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm);
+
+enum class BcastAlgorithm { BinaryHeap, Segmented, Binomial, KAry, Chain, ScatterAllgather };
+
+// Broadcast with the given algorithm
+int broadcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm, BcastAlgorithm algorithm);
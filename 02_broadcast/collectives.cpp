@@ -0,0 +1,250 @@
+// Copyright 2020 Vlasov Maksim
+#include <mpi.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "bcast_tree.h"
+#include "collectives.h"
+
+// Tags of the collectives, they do not intersect with the tags of the broadcast algorithms
+constexpr int REDUCE_TAG = 2;
+constexpr int ALLREDUCE_TAG = 3;
+constexpr int GATHER_TAG = 4;
+constexpr int SCATTER_TAG = 5;
+
+// Number of processes in the binomial subtree of the relative rank
+inline int subtree_size(int r_rank, int size) {
+    return r_rank == 0 ? size : std::min(r_rank & -r_rank, size - r_rank);
+}
+
+int reduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) {
+    int rank, size, commutative;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    MPI_Op_commutative(op, &commutative);
+    int tree_root = commutative ? root : 0;
+    // acc is the partial result, it is the input until something is received
+    const char *acc = static_cast<const char *>(sendbuf == MPI_IN_PLACE ? recvbuf : sendbuf);
+    std::vector<char> tmp_storage, next_storage;
+    char *tmp = nullptr, *next = nullptr;
+
+    int r_rank = relative_rank(rank, tree_root, size);
+    for (int mask = 1; mask < size; mask <<= 1) {
+        if (r_rank & mask) {
+            MPI_Send(acc, count, datatype, real_rank(r_rank - mask, tree_root, size), REDUCE_TAG, comm);
+            break;
+        }
+        if (r_rank + mask < size) {
+            if (tmp == nullptr) {
+                tmp = allocate_buffer(count, datatype, &tmp_storage);
+                next = allocate_buffer(count, datatype, &next_storage);
+            }
+            MPI_Recv(tmp, count, datatype, real_rank(r_rank + mask, tree_root, size), REDUCE_TAG, comm,
+                     MPI_STATUS_IGNORE);
+            // acc covers the relative ranks [x, x + mask), tmp covers [x + mask, x + 2 * mask)
+            MPI_Reduce_local(acc, tmp, count, datatype, op);
+            acc = tmp;
+            std::swap(tmp, next);
+        }
+    }
+    if (rank == tree_root && tree_root == root) {
+        if (acc != recvbuf)
+            copy_local(acc, count, datatype, recvbuf, count, datatype);
+    } else if (rank == tree_root) {
+        MPI_Send(acc, count, datatype, root, REDUCE_TAG, comm);
+    } else if (rank == root) {
+        MPI_Recv(recvbuf, count, datatype, tree_root, REDUCE_TAG, comm, MPI_STATUS_IGNORE);
+    }
+    return MPI_SUCCESS;
+}
+
+static void allreduce_recursive_doubling(void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op,
+                                         MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    int pof2 = 1;
+    while (pof2 * 2 <= size)
+        pof2 *= 2;
+    int rem = size - pof2;
+    std::vector<char> tmp_storage;
+    char *tmp = allocate_buffer(count, datatype, &tmp_storage);
+
+    // The first 2 * rem processes are paired, the odd one of each pair takes part in the exchanges
+    int new_rank;
+    if (rank < 2 * rem) {
+        if (rank % 2 == 0) {
+            MPI_Send(recvbuf, count, datatype, rank + 1, ALLREDUCE_TAG, comm);
+            new_rank = -1;
+        } else {
+            MPI_Recv(tmp, count, datatype, rank - 1, ALLREDUCE_TAG, comm, MPI_STATUS_IGNORE);
+            MPI_Reduce_local(tmp, recvbuf, count, datatype, op);
+            new_rank = rank / 2;
+        }
+    } else {
+        new_rank = rank - rem;
+    }
+    if (new_rank >= 0) {
+        for (int mask = 1; mask < pof2; mask <<= 1) {
+            int new_partner = new_rank ^ mask;
+            int partner = new_partner < rem ? new_partner * 2 + 1 : new_partner + rem;
+            MPI_Sendrecv(recvbuf, count, datatype, partner, ALLREDUCE_TAG, tmp, count, datatype, partner,
+                         ALLREDUCE_TAG, comm, MPI_STATUS_IGNORE);
+            // The lower ranks go first for non-commutative operators
+            if (partner < rank) {
+                MPI_Reduce_local(tmp, recvbuf, count, datatype, op);
+            } else {
+                MPI_Reduce_local(recvbuf, tmp, count, datatype, op);
+                copy_local(tmp, count, datatype, recvbuf, count, datatype);
+            }
+        }
+    }
+    if (rank < 2 * rem) {
+        if (rank % 2 == 0)
+            MPI_Recv(recvbuf, count, datatype, rank + 1, ALLREDUCE_TAG, comm, MPI_STATUS_IGNORE);
+        else
+            MPI_Send(recvbuf, count, datatype, rank - 1, ALLREDUCE_TAG, comm);
+    }
+}
+
+static void allreduce_ring(void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    MPI_Aint extent = datatype_extent(datatype);
+    std::vector<int> counts(size), displs(size);
+    for (int i = 0, displ = 0; i < size; i++) {
+        counts[i] = count / size + (i < count % size ? 1 : 0);
+        displs[i] = displ;
+        displ += counts[i];
+    }
+    std::vector<char> tmp_storage;
+    char *tmp = allocate_buffer(counts[0], datatype, &tmp_storage);
+    int left = (rank - 1 + size) % size;
+    int right = (rank + 1) % size;
+
+    // Reduce-scatter: after size-1 steps the process x holds the reduced block x+1
+    for (int step = 0; step < size - 1; step++) {
+        int send_block = (rank - step + size) % size;
+        int recv_block = (rank - step - 1 + size) % size;
+        MPI_Sendrecv(element_ptr(recvbuf, extent, displs[send_block]), counts[send_block], datatype, right,
+                     ALLREDUCE_TAG, tmp, counts[recv_block], datatype, left, ALLREDUCE_TAG, comm, MPI_STATUS_IGNORE);
+        MPI_Reduce_local(tmp, element_ptr(recvbuf, extent, displs[recv_block]), counts[recv_block], datatype, op);
+    }
+    // Allgather of the reduced blocks
+    for (int step = 0; step < size - 1; step++) {
+        int send_block = (rank + 1 - step + size) % size;
+        int recv_block = (rank - step + size) % size;
+        MPI_Sendrecv(element_ptr(recvbuf, extent, displs[send_block]), counts[send_block], datatype, right,
+                     ALLREDUCE_TAG, element_ptr(recvbuf, extent, displs[recv_block]), counts[recv_block], datatype,
+                     left, ALLREDUCE_TAG, comm, MPI_STATUS_IGNORE);
+    }
+}
+
+int allreduce(const void *sendbuf, void *recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm) {
+    int size, type_size, commutative;
+    MPI_Comm_size(comm, &size);
+    MPI_Type_size(datatype, &type_size);
+    MPI_Op_commutative(op, &commutative);
+    if (sendbuf != MPI_IN_PLACE)
+        copy_local(sendbuf, count, datatype, recvbuf, count, datatype);
+    if (size == 1)
+        return MPI_SUCCESS;
+    if (!commutative || count < size || static_cast<int64_t>(count) * type_size < ALLREDUCE_RING_BYTES)
+        allreduce_recursive_doubling(recvbuf, count, datatype, op, comm);
+    else
+        allreduce_ring(recvbuf, count, datatype, op, comm);
+    return MPI_SUCCESS;
+}
+
+int gather(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount,
+           MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    MPI_Aint recv_extent = rank == root ? datatype_extent(recvtype) : 0;
+    bool in_place = rank == root && sendbuf == MPI_IN_PLACE;
+    // With MPI_IN_PLACE the root describes its blocks with the receive datatype
+    int block_count = in_place ? recvcount : sendcount;
+    MPI_Datatype block_type = in_place ? recvtype : sendtype;
+    MPI_Aint block_extent = static_cast<MPI_Aint>(block_count) * datatype_extent(block_type);
+
+    int r_rank = relative_rank(rank, root, size);
+    int subtree = subtree_size(r_rank, size);
+    std::vector<char> storage;
+    char *blocks = allocate_buffer(subtree * block_count, block_type, &storage);
+    if (in_place)
+        copy_local(element_ptr(recvbuf, recv_extent, rank * recvcount), recvcount, recvtype, blocks, block_count,
+                   block_type);
+    else
+        copy_local(sendbuf, sendcount, sendtype, blocks, block_count, block_type);
+
+    for (int mask = 1; mask < size; mask <<= 1) {
+        if (r_rank & mask) {
+            MPI_Send(blocks, subtree * block_count, block_type, real_rank(r_rank - mask, root, size), GATHER_TAG,
+                     comm);
+            break;
+        }
+        if (r_rank + mask < size) {
+            int child_blocks = std::min(mask, size - r_rank - mask);
+            MPI_Recv(blocks + mask * block_extent, child_blocks * block_count, block_type,
+                     real_rank(r_rank + mask, root, size), GATHER_TAG, comm, MPI_STATUS_IGNORE);
+        }
+    }
+    if (rank == root) {
+        for (int block = in_place ? 1 : 0; block < size; block++)
+            copy_local(blocks + block * block_extent, block_count, block_type,
+                       element_ptr(recvbuf, recv_extent, real_rank(block, root, size) * recvcount), recvcount,
+                       recvtype);
+    }
+    return MPI_SUCCESS;
+}
+
+int scatter(const void *sendbuf, int sendcount, MPI_Datatype sendtype, void *recvbuf, int recvcount,
+            MPI_Datatype recvtype, int root, MPI_Comm comm) {
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    // The root describes the blocks with the send datatype, the other processes with the receive one
+    int block_count = rank == root ? sendcount : recvcount;
+    MPI_Datatype block_type = rank == root ? sendtype : recvtype;
+    MPI_Aint block_extent = static_cast<MPI_Aint>(block_count) * datatype_extent(block_type);
+
+    int r_rank = relative_rank(rank, root, size);
+    int subtree = subtree_size(r_rank, size);
+    std::vector<char> storage;
+    char *blocks;
+    if (rank == root && root == 0) {
+        // The relative order is the real one
+        blocks = static_cast<char *>(const_cast<void *>(sendbuf));
+    } else if (rank == root) {
+        blocks = allocate_buffer(size * block_count, block_type, &storage);
+        for (int block = 0; block < size; block++)
+            copy_local(static_cast<const char *>(sendbuf) + real_rank(block, root, size) * block_extent, block_count,
+                       block_type, blocks + block * block_extent, block_count, block_type);
+    } else if (subtree == 1) {
+        // A leaf receives its block in place
+        blocks = static_cast<char *>(recvbuf);
+    } else {
+        blocks = allocate_buffer(subtree * block_count, block_type, &storage);
+    }
+
+    int mask = 1;
+    for (; mask < size; mask <<= 1) {
+        if (r_rank & mask) {
+            MPI_Recv(blocks, subtree * block_count, block_type, real_rank(r_rank - mask, root, size), SCATTER_TAG,
+                     comm, MPI_STATUS_IGNORE);
+            break;
+        }
+    }
+    for (mask >>= 1; mask > 0; mask >>= 1) {
+        if (r_rank + mask < size) {
+            int child_blocks = std::min(mask, size - r_rank - mask);
+            MPI_Send(blocks + mask * block_extent, child_blocks * block_count, block_type,
+                     real_rank(r_rank + mask, root, size), SCATTER_TAG, comm);
+        }
+    }
+    if (rank == root ? recvbuf != MPI_IN_PLACE : subtree > 1)
+        copy_local(blocks, block_count, block_type, recvbuf, recvcount, recvtype);
+    return MPI_SUCCESS;
+}
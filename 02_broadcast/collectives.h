@@ -0,0 +1,53 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+
+// Messages of allreduce above this size in bytes use the ring algorithm
+constexpr int ALLREDUCE_RING_BYTES = 65536;
+
+/**
+ * Performs the same action as MPI_Reduce does
+ * 
+ * Binomial tree over the ranks relative to the root: at step j the process x
+ * with bit j set sends its partial result to x-2^j, which combines it with
+ * MPI_Reduce_local. Every partial result covers a contiguous range of ranks, so
+ * for non-commutative operators the tree is rooted at the process 0 (where the
+ * relative ranks are the real ones) and the result is sent to the root.
+ * MPI_IN_PLACE is accepted as sendbuf on the root.
+ */
+int reduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm);
+
+/**
+ * Performs the same action as MPI_Allreduce does
+ * 
+ * Small messages (below ALLREDUCE_RING_BYTES), messages with fewer elements than
+ * processes and non-commutative operators use recursive doubling: log2(size)
+ * rounds of pairwise exchanges of the whole vector, the processes above the
+ * largest power of two are folded into their neighbours first.
+ * 
+ * Large messages use the ring algorithm: a reduce-scatter in size-1 steps leaves
+ * every process with one reduced block, then a ring allgather distributes the
+ * blocks. Each process sends about 2 * message size in total, independently of
+ * the number of processes.
+ */
+int allreduce(const void* sendbuf, void* recvbuf, int count, MPI_Datatype datatype, MPI_Op op, MPI_Comm comm);
+
+/**
+ * Performs the same action as MPI_Gather does
+ * 
+ * Binomial tree: the process with relative rank x collects the blocks of its
+ * subtree [x, x + lowest set bit of x) and sends them to its parent in one
+ * message. The root reorders the blocks into recvbuf by the real ranks.
+ */
+int gather(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+           MPI_Datatype recvtype, int root, MPI_Comm comm);
+
+/**
+ * Performs the same action as MPI_Scatter does
+ * 
+ * Binomial tree, the reverse of gather: every process receives the blocks of its
+ * whole subtree from its parent and passes the halves on to its children.
+ */
+int scatter(const void* sendbuf, int sendcount, MPI_Datatype sendtype, void* recvbuf, int recvcount,
+            MPI_Datatype recvtype, int root, MPI_Comm comm);
@@ -0,0 +1,98 @@
+// Copyright 2020 Vlasov Maksim
+#include <mpi.h>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+#include "bcast_tree.h"
+#include "broadcast.h"
+#include "hierarchical_broadcast.h"
+
+// Initial size of the node windows in bytes
+constexpr MPI_Aint HIERARCHICAL_INITIAL_CAPACITY = 1 << 16;
+
+HierarchicalBroadcast::HierarchicalBroadcast(MPI_Comm comm, int ranks_per_node)
+    : window_(MPI_WIN_NULL), base_(nullptr), capacity_(0) {
+    if (ranks_per_node < 0)
+        throw std::runtime_error("Ranks per node can not be negative");
+    MPI_Comm_dup(comm, &comm_);
+    MPI_Comm_rank(comm_, &rank_);
+    MPI_Comm shared_comm;
+    MPI_Comm_split_type(comm_, MPI_COMM_TYPE_SHARED, rank_, MPI_INFO_NULL, &shared_comm);
+    if (ranks_per_node > 0) {
+        int shared_rank;
+        MPI_Comm_rank(shared_comm, &shared_rank);
+        MPI_Comm_split(shared_comm, shared_rank / ranks_per_node, shared_rank, &node_comm_);
+        MPI_Comm_free(&shared_comm);
+    } else {
+        node_comm_ = shared_comm;
+    }
+    MPI_Comm_rank(node_comm_, &node_rank_);
+    MPI_Comm_split(comm_, node_rank_ == 0 ? 0 : MPI_UNDEFINED, rank_, &leaders_comm_);
+    node_ = 0;
+    if (node_rank_ == 0)
+        MPI_Comm_rank(leaders_comm_, &node_);
+    MPI_Bcast(&node_, 1, MPI_INT, 0, node_comm_);
+    int size;
+    MPI_Comm_size(comm_, &size);
+    node_of_rank_.resize(size);
+    MPI_Allgather(&node_, 1, MPI_INT, node_of_rank_.data(), 1, MPI_INT, comm_);
+    nodes_count_ = *std::max_element(node_of_rank_.begin(), node_of_rank_.end()) + 1;
+    allocate(HIERARCHICAL_INITIAL_CAPACITY);
+}
+
+HierarchicalBroadcast::~HierarchicalBroadcast() {
+    MPI_Win_unlock_all(window_);
+    MPI_Win_free(&window_);
+    if (leaders_comm_ != MPI_COMM_NULL)
+        MPI_Comm_free(&leaders_comm_);
+    MPI_Comm_free(&node_comm_);
+    MPI_Comm_free(&comm_);
+}
+
+void HierarchicalBroadcast::allocate(MPI_Aint capacity) {
+    if (window_ != MPI_WIN_NULL) {
+        MPI_Win_unlock_all(window_);
+        MPI_Win_free(&window_);
+    }
+    // The whole window belongs to the leader, the other processes get a pointer to it
+    void* local_base;
+    MPI_Win_allocate_shared(node_rank_ == 0 ? capacity : 0, 1, MPI_INFO_NULL, node_comm_, &local_base, &window_);
+    MPI_Aint size;
+    int disp_unit;
+    MPI_Win_shared_query(window_, 0, &size, &disp_unit, &base_);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, window_);
+    capacity_ = capacity;
+}
+
+const void* HierarchicalBroadcast::publish(const void* buffer, int count, MPI_Datatype datatype, int root) {
+    MPI_Aint lb, extent;
+    MPI_Type_get_extent(datatype, &lb, &extent);
+    MPI_Aint bytes = static_cast<MPI_Aint>(count) * extent;
+    // Both ways synchronize the node, so nobody reads the previous data anymore
+    if (bytes > capacity_)
+        allocate(std::max(bytes, 2 * capacity_));
+    else
+        MPI_Barrier(node_comm_);
+
+    int root_node = node_of_rank_[root];
+    if (node_ == root_node) {
+        if (rank_ == root)
+            copy_local(buffer, count, datatype, base_, count, datatype);
+        MPI_Win_sync(window_);
+        MPI_Barrier(node_comm_);
+        MPI_Win_sync(window_);
+    }
+    if (leaders_comm_ != MPI_COMM_NULL)
+        ::broadcast(base_, count, datatype, root_node, leaders_comm_);
+    MPI_Win_sync(window_);
+    MPI_Barrier(node_comm_);
+    MPI_Win_sync(window_);
+    return base_;
+}
+
+int HierarchicalBroadcast::broadcast(void* buffer, int count, MPI_Datatype datatype, int root) {
+    const void* data = publish(buffer, count, datatype, root);
+    if (rank_ != root)
+        copy_local(data, count, datatype, buffer, count, datatype);
+    return MPI_SUCCESS;
+}
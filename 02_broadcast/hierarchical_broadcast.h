@@ -0,0 +1,47 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <vector>
+
+/**
+ * Two-level broadcast for communicators spanning several shared-memory nodes
+ * 
+ * The communicator is split by node (MPI_Comm_split_type with
+ * MPI_COMM_TYPE_SHARED), the process with node rank 0 is the node leader. Every
+ * node has a window allocated with MPI_Win_allocate_shared. The root copies its
+ * buffer into the window of its node, then the leaders broadcast it with the
+ * binary heap of broadcast() over the leaders communicator, receiving directly
+ * into their windows. The other processes read the window of their node, so the
+ * data crosses the network once per node and is not copied inside a node.
+ * 
+ * If ranks_per_node is positive, the shared-memory nodes are split further into
+ * groups of ranks_per_node processes, which emulates smaller nodes on a single
+ * machine.
+ */
+class HierarchicalBroadcast {
+public:
+    explicit HierarchicalBroadcast(MPI_Comm comm = MPI_COMM_WORLD, int ranks_per_node = 0);
+    HierarchicalBroadcast(const HierarchicalBroadcast&) = delete;
+    HierarchicalBroadcast& operator=(const HierarchicalBroadcast&) = delete;
+    ~HierarchicalBroadcast();
+
+    // Collective. Returns the node-shared copy of the root's buffer, it is valid until the next call.
+    // The window grows when the message does not fit, so all processes must pass the same count.
+    const void* publish(const void* buffer, int count, MPI_Datatype datatype, int root);
+    // Collective. Same as publish, but the data is copied into buffer on every process.
+    int broadcast(void* buffer, int count, MPI_Datatype datatype, int root);
+
+    int nodesCount() const { return nodes_count_; }
+
+private:
+    void allocate(MPI_Aint capacity);
+
+    MPI_Comm comm_, node_comm_, leaders_comm_;
+    int rank_, node_rank_, node_, nodes_count_;
+    // Node of every process of comm_, which is the rank of its leader in leaders_comm_
+    std::vector<int> node_of_rank_;
+    MPI_Win window_;
+    void* base_;
+    MPI_Aint capacity_;
+};
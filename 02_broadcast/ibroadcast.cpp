@@ -0,0 +1,141 @@
+// Copyright 2020 Vlasov Maksim
+#include <mpi.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ibroadcast.h"
+#include "bcast_tree.h"
+
+// Tags of ibroadcast messages, they do not intersect with the tags of the blocking algorithms
+constexpr int IBROADCAST_FIRST_TAG = 16;
+constexpr int IBROADCAST_TAGS_COUNT = 16384;
+
+static int delete_counter(MPI_Comm, int, void* attribute, void*) {
+    delete static_cast<int*>(attribute);
+    return MPI_SUCCESS;
+}
+
+// Tag of the next ibroadcast on the communicator, the counter is cached as an attribute of it
+static int next_tag(MPI_Comm comm) {
+    static int keyval = MPI_KEYVAL_INVALID;
+    if (keyval == MPI_KEYVAL_INVALID)
+        MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, delete_counter, &keyval, nullptr);
+    int* counter;
+    int flag;
+    MPI_Comm_get_attr(comm, keyval, &counter, &flag);
+    if (!flag) {
+        counter = new int(0);
+        MPI_Comm_set_attr(comm, keyval, counter);
+    }
+    int tag = IBROADCAST_FIRST_TAG + *counter;
+    *counter = (*counter + 1) % IBROADCAST_TAGS_COUNT;
+    return tag;
+}
+
+BcastRequest::~BcastRequest() {
+    if (active_)
+        wait();
+}
+
+bool BcastRequest::progress() {
+    if (completed_)
+        return true;
+    if (!received_) {
+        int flag;
+        MPI_Test(&recv_request_, &flag, MPI_STATUS_IGNORE);
+        if (!flag)
+            return false;
+        received_ = true;
+    }
+    if (!forwarded_) {
+        send_requests_.resize(children_.size());
+        for (size_t i = 0; i < children_.size(); i++)
+            MPI_Isend(buffer_, count_, datatype_, children_[i], tag_, comm_, &send_requests_[i]);
+        forwarded_ = true;
+    }
+    if (!send_requests_.empty()) {
+        int flag;
+        MPI_Testall(static_cast<int>(send_requests_.size()), send_requests_.data(), &flag, MPI_STATUSES_IGNORE);
+        if (!flag)
+            return false;
+    }
+    completed_ = true;
+    return true;
+}
+
+bool BcastRequest::test() {
+    if (!active_)
+        return true;
+    bool completed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        completed = progress();
+    }
+    if (completed)
+        wait();
+    return completed;
+}
+
+void BcastRequest::wait() {
+    if (!active_)
+        return;
+    if (thread_.joinable()) {
+        // The thread finishes when the broadcast is completed
+        thread_.join();
+    } else {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!received_) {
+            MPI_Wait(&recv_request_, MPI_STATUS_IGNORE);
+            received_ = true;
+        }
+        progress();
+        if (!send_requests_.empty())
+            MPI_Waitall(static_cast<int>(send_requests_.size()), send_requests_.data(), MPI_STATUSES_IGNORE);
+        completed_ = true;
+    }
+    active_ = false;
+}
+
+int ibroadcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm, BcastRequest* request,
+               bool progress_thread) {
+    if (request == nullptr || request->active_)
+        return MPI_ERR_ARG;
+    int rank, size;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &size);
+    request->buffer_ = buffer;
+    request->count_ = count;
+    request->datatype_ = datatype;
+    request->comm_ = comm;
+    request->tag_ = next_tag(comm);
+    request->children_ = heap_children(rank, root, size, 2);
+    request->send_requests_.clear();
+    request->received_ = rank == root;
+    request->forwarded_ = false;
+    request->completed_ = false;
+    request->active_ = true;
+    if (rank != root)
+        MPI_Irecv(buffer, count, datatype, heap_parent(rank, root, 2), request->tag_, comm,
+                  &request->recv_request_);
+    {
+        // The root can post its sends at once
+        std::lock_guard<std::mutex> lock(request->mutex_);
+        request->progress();
+    }
+
+    int provided;
+    MPI_Query_thread(&provided);
+    if (progress_thread && provided == MPI_THREAD_MULTIPLE) {
+        request->thread_ = std::thread([request]() {
+            for (;;) {
+                {
+                    std::lock_guard<std::mutex> lock(request->mutex_);
+                    if (request->progress())
+                        return;
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+    return MPI_SUCCESS;
+}
@@ -0,0 +1,76 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Handle of a broadcast started by ibroadcast
+ * 
+ * The broadcast goes along the same binary heap as broadcast(). A process first
+ * waits for the data from its parent and then forwards it to its children, and
+ * both steps are done with non-blocking requests. They are progressed by test()
+ * and wait(), or by a progress thread if it was requested.
+ * 
+ * The buffer must not be touched until the request is completed. The destructor
+ * waits for an active request.
+ */
+class BcastRequest {
+public:
+    BcastRequest() = default;
+    BcastRequest(const BcastRequest&) = delete;
+    BcastRequest& operator=(const BcastRequest&) = delete;
+    ~BcastRequest();
+
+    // Makes progress without blocking, returns true if the broadcast is completed
+    bool test();
+    // Blocks until the broadcast is completed
+    void wait();
+    bool active() const { return active_; }
+    // The broadcast is progressed by a background thread
+    bool progressThread() const { return thread_.joinable(); }
+
+private:
+    friend int ibroadcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm,
+                          BcastRequest* request, bool progress_thread);
+
+    // Must be called with the mutex locked
+    bool progress();
+
+    void* buffer_ = nullptr;
+    int count_ = 0;
+    MPI_Datatype datatype_ = MPI_DATATYPE_NULL;
+    MPI_Comm comm_ = MPI_COMM_NULL;
+    int tag_ = 0;
+    std::vector<int> children_;
+    MPI_Request recv_request_ = MPI_REQUEST_NULL;
+    std::vector<MPI_Request> send_requests_;
+    bool received_ = false;
+    bool forwarded_ = false;
+    bool completed_ = false;
+    bool active_ = false;
+
+    std::mutex mutex_;
+    std::thread thread_;
+};
+
+/**
+ * Non-blocking version of broadcast
+ * 
+ * Starts the broadcast and returns at once; the caller may compute while the
+ * data is received and forwarded, and completes the broadcast with
+ * request->test() or request->wait(). All processes must start their
+ * ibroadcasts on a communicator in the same order, then several of them may be
+ * active at once: every ibroadcast gets its own tag from a counter cached on the
+ * communicator.
+ * 
+ * If progress_thread is true and MPI was initialized with MPI_THREAD_MULTIPLE,
+ * a thread polls the requests so the forwarding does not depend on the caller
+ * calling test(). With a lower thread support level the flag is ignored.
+ * 
+ * Returns MPI_ERR_ARG if request is null or still active.
+ */
+int ibroadcast(void* buffer, int count, MPI_Datatype datatype, int root, MPI_Comm comm, BcastRequest* request,
+               bool progress_thread = false);
@@ -3,10 +3,20 @@
 #include <gtest-mpi-listener.hpp>
 #include <gtest/gtest.h>
 #include <math.h>
+#include <cstdio>
+#include <fstream>
+#include <functional>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <algorithm>
 #include "broadcast.h"
+#include "bcast_tuner.h"
+#include "ibroadcast.h"
+#include "hierarchical_broadcast.h"
+#include "bcast_aggregator.h"
+#include "typed_broadcast.h"
+#include "collectives.h"
 
 namespace pi_calc {
     constexpr double PI25DT = 3.141592653589793238462643;
@@ -55,7 +65,7 @@ namespace pi_calc {
             sum += integral(x);
         }
         double part = h * sum;
-        MPI_Reduce(&part, &result, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        reduce(&part, &result, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
         if (rank == 0) {
             t2 = MPI_Wtime();
             log(__FUNCTION__, result, t2 - t1);
@@ -88,6 +98,26 @@ namespace pi_calc {
     }
 }  // namespace pi_calc
 
+namespace collectives_test {
+    // Product of 2x2 matrices modulo a prime, an associative but not commutative operator
+    void matrixProduct(void* in, void* inout, int* len, MPI_Datatype*) {
+        const int* a = static_cast<const int*>(in);
+        int* b = static_cast<int*>(inout);
+        for (int i = 0; i < *len; i++, a += 4, b += 4) {
+            int product[4] = { (a[0] * b[0] + a[1] * b[2]) % 1009, (a[0] * b[1] + a[1] * b[3]) % 1009,
+                               (a[2] * b[0] + a[3] * b[2]) % 1009, (a[2] * b[1] + a[3] * b[3]) % 1009 };
+            std::copy(product, product + 4, b);
+        }
+    }
+
+    std::vector<int> rankValues(int rank, int count) {
+        std::vector<int> values(count);
+        for (int i = 0; i < count; i++)
+            values[i] = (rank * 31 + i * 17) % 1009;
+        return values;
+    }
+}  // namespace collectives_test
+
 TEST(Bcast_Impl_MPI, Vector5_Int) {
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
@@ -152,13 +182,626 @@ TEST(Bcast_Impl_MPI, Performance_Vector500) {
     if (rank == 0) {
         t2 = MPI_Wtime();
         std::cout << "MPI_bcast: " << (t2 - t1) << std::endl;
-        SUCCEED();
+    }
+
+    // Latency of small messages and bandwidth of a large one for k-ary heaps
+    const int large_count = 1 << 20;
+    std::vector<int> large(large_count, rank == 0 ? value : 0);
+    auto measure = [&](const std::string& label, const std::function<void(void*, int)>& bcast) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        double start = MPI_Wtime();
+        for (int i = 0; i < size; i++)
+            bcast(v.data() + i, 1);
+        MPI_Barrier(MPI_COMM_WORLD);
+        double middle = MPI_Wtime();
+        bcast(large.data(), large_count);
+        MPI_Barrier(MPI_COMM_WORLD);
+        double end = MPI_Wtime();
+        if (rank == 0) {
+            std::cout << label << ": latency=" << (middle - start) / size * 1e6 << "us"
+                      << ", bandwidth=" << large_count * sizeof(int) / (end - middle) / (1 << 20) << "MiB/s"
+                      << std::endl;
+        }
+    };
+    for (int fanout = 2; fanout <= 8; fanout++) {
+        measure("k=" + std::to_string(fanout), [fanout](void* buffer, int count) {
+            broadcastKAry(buffer, count, MPI_INT, 0, MPI_COMM_WORLD, fanout);
+        });
+    }
+    measure("MPI_Bcast", [](void* buffer, int count) { MPI_Bcast(buffer, count, MPI_INT, 0, MPI_COMM_WORLD); });
+    ASSERT_EQ(std::vector<int>(size, value), v);
+    ASSERT_EQ(std::vector<int>(large_count, value), large);
+}
+
+TEST(Bcast_Impl_MPI, Vector5_Int_Last_Root) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    std::vector<int> v(5);
+    if (rank == size - 1)
+        v = { 0, 1, 2, 3, 4 };
+    broadcast(v.data(), 5, MPI_INT, size - 1, MPI_COMM_WORLD);
+    ASSERT_EQ(v, std::vector<int>({ 0, 1, 2, 3, 4 }));
+}
+
+TEST(Bcast_Impl_MPI, Segmented_Vector100000_Int) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int count = 100000;
+    std::vector<int> expected(count);
+    for (int i = 0; i < count; i++)
+        expected[i] = i * 7 - 3;
+    for (int root : { 0, size - 1, size / 2 }) {
+        for (int segment_size : { 0, 1000, 7, 100000, 200000 }) {
+            std::vector<int> v(count);
+            if (rank == root)
+                v = expected;
+            broadcastSegmented(v.data(), count, MPI_INT, root, MPI_COMM_WORLD, segment_size);
+            ASSERT_EQ(expected, v);
+        }
+    }
+}
+
+TEST(Bcast_Impl_MPI, Segmented_Vector0_Double) {
+    std::vector<double> v;
+    ASSERT_EQ(MPI_SUCCESS, broadcastSegmented(v.data(), 0, MPI_DOUBLE, 0, MPI_COMM_WORLD));
+}
+
+TEST(Bcast_Impl_MPI, Performance_Segmented_Large_Vector) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int count = 1 << 21;
+    std::vector<double> v(count, rank == 0 ? 1.5 : 0.);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t1 = MPI_Wtime();
+    broadcast(v.data(), count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t2 = MPI_Wtime();
+    broadcastSegmented(v.data(), count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t3 = MPI_Wtime();
+    MPI_Bcast(v.data(), count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t4 = MPI_Wtime();
+    if (rank == 0) {
+        std::cout << "procs=" << size << " bytes=" << count * sizeof(double) << ": my_bcast=" << (t2 - t1)
+                  << ", segmented=" << (t3 - t2) << ", MPI_bcast=" << (t4 - t3) << std::endl;
+    }
+    ASSERT_EQ(std::vector<double>(count, 1.5), v);
+}
+
+TEST(Bcast_Impl_MPI, All_Algorithms_All_Roots) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const BcastAlgorithm algorithms[] = { BcastAlgorithm::BinaryHeap, BcastAlgorithm::Segmented,
+                                          BcastAlgorithm::Binomial,   BcastAlgorithm::KAry,
+                                          BcastAlgorithm::Chain,      BcastAlgorithm::ScatterAllgather };
+    for (BcastAlgorithm algorithm : algorithms) {
+        for (int root : { 0, size - 1, size / 2 }) {
+            for (int count : { 0, 1, 5, 1000, 100003 }) {
+                std::vector<int> expected(count);
+                for (int i = 0; i < count; i++)
+                    expected[i] = i * 3 + root;
+                std::vector<int> v(count, -1);
+                if (rank == root)
+                    v = expected;
+                ASSERT_EQ(MPI_SUCCESS, broadcast(v.data(), count, MPI_INT, root, MPI_COMM_WORLD, algorithm));
+                ASSERT_EQ(expected, v) << bcastAlgorithmName(algorithm) << " root=" << root << " count=" << count;
+            }
+        }
+    }
+}
+
+TEST(Bcast_Impl_MPI, KAry_Fanouts) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    for (int fanout : { 1, 2, 3, 5, 8 }) {
+        std::vector<double> v(17, rank == size - 1 ? 2.5 : 0.);
+        ASSERT_EQ(MPI_SUCCESS, broadcastKAry(v.data(), 17, MPI_DOUBLE, size - 1, MPI_COMM_WORLD, fanout));
+        ASSERT_EQ(std::vector<double>(17, 2.5), v);
+    }
+}
+
+TEST(Bcast_Impl_MPI, KAry_Cannot_Accept_Zero_Fanout) {
+    int value = 1;
+    ASSERT_EQ(MPI_ERR_ARG, broadcastKAry(&value, 1, MPI_INT, 0, MPI_COMM_WORLD, 0));
+}
+
+TEST(Bcast_Impl_MPI, Tuner_Save_Load_Round_Trip) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const std::string file_name = "bcast_tuner_test.txt";
+    BcastTuner tuner;
+    tuner.tune(MPI_COMM_WORLD, 1 << 12, 2);
+    bool saved = rank == 0 ? tuner.save(file_name) : true;
+    ASSERT_TRUE(saved);
+    MPI_Barrier(MPI_COMM_WORLD);
+    BcastTuner loaded;
+    ASSERT_TRUE(loaded.load(file_name, MPI_COMM_WORLD));
+    for (int bytes : { 0, 1, 100, 1 << 12, 1 << 20 })
+        for (int comm_size : { 1, size, size + 5 })
+            ASSERT_EQ(tuner.select(bytes, comm_size), loaded.select(bytes, comm_size));
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0)
+        std::remove(file_name.c_str());
+    ASSERT_FALSE(loaded.load("missing_bcast_tuner_file.txt", MPI_COMM_WORLD));
+}
+
+TEST(Bcast_Impl_MPI, Tuner_Cannot_Load_Corrupt_File) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    const std::string file_name = "bcast_tuner_corrupt.txt";
+    const char *contents[] = { "1 0 binomial\n2 oops\n", "1 0 binomial\n2 1024 fastest\n" };
+    for (const char *content : contents) {
+        if (rank == 0) {
+            std::ofstream file(file_name);
+            file << content;
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        BcastTuner tuner;
+        ASSERT_FALSE(tuner.load(file_name, MPI_COMM_WORLD));
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+    if (rank == 0)
+        std::remove(file_name.c_str());
+}
+
+TEST(Bcast_Impl_MPI, Tuned_Vector100003_Int) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int count = 100003;
+    std::vector<int> v(count, rank == size / 2 ? 11 : 0);
+    ASSERT_EQ(MPI_SUCCESS, broadcastTuned(v.data(), count, MPI_INT, size / 2, MPI_COMM_WORLD));
+    ASSERT_EQ(std::vector<int>(count, 11), v);
+}
+
+TEST(Bcast_Impl_MPI, Ibroadcast_Vector100000_Int_All_Roots) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int count = 100000;
+    for (int root : { 0, size - 1, size / 2 }) {
+        std::vector<int> v(count, rank == root ? root + 1 : 0);
+        BcastRequest request;
+        ASSERT_EQ(MPI_SUCCESS, ibroadcast(v.data(), count, MPI_INT, root, MPI_COMM_WORLD, &request));
+        double sum = 0.;
+        for (int i = 1; !request.test(); i++)
+            sum += pi_calc::integral(1. / i);
+        ASSERT_FALSE(request.active());
+        ASSERT_EQ(std::vector<int>(count, root + 1), v);
+    }
+}
+
+TEST(Bcast_Impl_MPI, Ibroadcast_Several_Active_Requests) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int roots_count = 3;
+    const int roots[roots_count] = { size - 1, 0, size / 2 };
+    std::vector<std::vector<double>> v(roots_count);
+    BcastRequest requests[roots_count];
+    for (int i = 0; i < roots_count; i++) {
+        v[i].assign(1000, rank == roots[i] ? i + 0.5 : 0.);
+        ASSERT_EQ(MPI_SUCCESS, ibroadcast(v[i].data(), 1000, MPI_DOUBLE, roots[i], MPI_COMM_WORLD, &requests[i]));
+    }
+    // Blocking broadcasts do not interfere with the active requests
+    int value = rank == 0 ? 7 : 0;
+    broadcast(&value, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    ASSERT_EQ(7, value);
+    for (int i = roots_count - 1; i >= 0; i--) {
+        requests[i].wait();
+        ASSERT_EQ(std::vector<double>(1000, i + 0.5), v[i]);
+    }
+}
+
+TEST(Bcast_Impl_MPI, Ibroadcast_Progress_Thread) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    int provided;
+    MPI_Query_thread(&provided);
+    std::vector<int> v(5000, rank == 0 ? 3 : 0), w(5000, rank == 0 ? 4 : 0);
+    BcastRequest request, polled_request;
+    ASSERT_EQ(MPI_SUCCESS, ibroadcast(v.data(), 5000, MPI_INT, 0, MPI_COMM_WORLD, &request, true));
+    ASSERT_EQ(MPI_SUCCESS, ibroadcast(w.data(), 5000, MPI_INT, 0, MPI_COMM_WORLD, &polled_request, true));
+    // Without MPI_THREAD_MULTIPLE the thread is not started and wait() progresses the broadcast
+    ASSERT_EQ(provided == MPI_THREAD_MULTIPLE, request.progressThread());
+    ASSERT_EQ(provided == MPI_THREAD_MULTIPLE, polled_request.progressThread());
+    request.wait();
+    ASSERT_FALSE(request.progressThread());
+    ASSERT_EQ(std::vector<int>(5000, 3), v);
+    while (!polled_request.test()) {
+    }
+    ASSERT_FALSE(polled_request.progressThread());
+    ASSERT_EQ(std::vector<int>(5000, 4), w);
+}
+
+TEST(Bcast_Impl_MPI, Ibroadcast_Cannot_Accept_Active_Request) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    int first = rank == 0 ? 1 : 0, second = 0;
+    BcastRequest request;
+    ASSERT_EQ(MPI_ERR_ARG, ibroadcast(&first, 1, MPI_INT, 0, MPI_COMM_WORLD, nullptr));
+    ASSERT_EQ(MPI_SUCCESS, ibroadcast(&first, 1, MPI_INT, 0, MPI_COMM_WORLD, &request));
+    ASSERT_EQ(MPI_ERR_ARG, ibroadcast(&second, 1, MPI_INT, 0, MPI_COMM_WORLD, &request));
+    request.wait();
+    ASSERT_EQ(1, first);
+}
+
+TEST(Bcast_Impl_MPI, Performance_Ibroadcast_Overlap) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int count = 1 << 20;
+    const int iter = 10000000;
+    std::vector<int> v(count, rank == 0 ? 1 : 0);
+    // Local work which does not depend on the broadcast data
+    auto compute = [&](BcastRequest* request) {
+        double sum = 0., h = 1. / iter;
+        for (int i = rank + 1; i <= iter; i += size) {
+            sum += pi_calc::integral(h * (i - 0.5));
+            if (request != nullptr && i % 4096 == 1)
+                request->test();
+        }
+        return h * sum;
+    };
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t1 = MPI_Wtime();
+    broadcast(v.data(), count, MPI_INT, 0, MPI_COMM_WORLD);
+    double blocking = compute(nullptr);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t2 = MPI_Wtime();
+    BcastRequest request;
+    ibroadcast(v.data(), count, MPI_INT, 0, MPI_COMM_WORLD, &request);
+    double overlapped = compute(&request);
+    request.wait();
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t3 = MPI_Wtime();
+    if (rank == 0)
+        std::cout << "broadcast+compute=" << (t2 - t1) << ", ibroadcast+compute=" << (t3 - t2) << std::endl;
+    ASSERT_EQ(blocking, overlapped);
+    ASSERT_EQ(std::vector<int>(count, 1), v);
+}
+
+TEST(Bcast_Impl_MPI, Hierarchical_All_Roots) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    for (int ranks_per_node : { 0, 1, 2, 3 }) {
+        HierarchicalBroadcast hierarchical(MPI_COMM_WORLD, ranks_per_node);
+        if (ranks_per_node > 0) {
+            ASSERT_EQ((size + ranks_per_node - 1) / ranks_per_node, hierarchical.nodesCount());
+        }
+        for (int root : { 0, size - 1, size / 2 }) {
+            // The last count does not fit into the initial window
+            for (int count : { 0, 5, 300000 }) {
+                std::vector<int> expected(count);
+                for (int i = 0; i < count; i++)
+                    expected[i] = i - root;
+                std::vector<int> v(count);
+                if (rank == root)
+                    v = expected;
+                ASSERT_EQ(MPI_SUCCESS, hierarchical.broadcast(v.data(), count, MPI_INT, root));
+                ASSERT_EQ(expected, v);
+                const int* shared = static_cast<const int*>(hierarchical.publish(v.data(), count, MPI_INT, root));
+                ASSERT_EQ(expected, std::vector<int>(shared, shared + count));
+            }
+        }
+    }
+}
+
+TEST(Bcast_Impl_MPI, Hierarchical_Cannot_Accept_Negative_Ranks_Per_Node) {
+    ASSERT_ANY_THROW(HierarchicalBroadcast(MPI_COMM_WORLD, -1));
+}
+
+TEST(Bcast_Impl_MPI, Performance_Hierarchical_vs_Flat) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int iterations = 10;
+    for (int ranks_per_node : { 0, 2 }) {
+        HierarchicalBroadcast hierarchical(MPI_COMM_WORLD, ranks_per_node);
+        for (int count : { 256, 16384, 1 << 20 }) {
+            std::vector<int> v(count, rank == 0 ? 1 : 0);
+            double times[4];
+            for (int variant = 0; variant < 4; variant++) {
+                MPI_Barrier(MPI_COMM_WORLD);
+                double t1 = MPI_Wtime();
+                for (int i = 0; i < iterations; i++) {
+                    if (variant == 0)
+                        broadcast(v.data(), count, MPI_INT, 0, MPI_COMM_WORLD);
+                    else if (variant == 1)
+                        MPI_Bcast(v.data(), count, MPI_INT, 0, MPI_COMM_WORLD);
+                    else if (variant == 2)
+                        hierarchical.broadcast(v.data(), count, MPI_INT, 0);
+                    else
+                        hierarchical.publish(v.data(), count, MPI_INT, 0);
+                }
+                MPI_Barrier(MPI_COMM_WORLD);
+                times[variant] = (MPI_Wtime() - t1) / iterations;
+            }
+            if (rank == 0) {
+                std::cout << "procs=" << size << " nodes=" << hierarchical.nodesCount()
+                          << " bytes=" << count * sizeof(int) << ": my_bcast=" << times[0]
+                          << ", MPI_bcast=" << times[1] << ", hierarchical=" << times[2]
+                          << ", hierarchical_zero_copy=" << times[3] << std::endl;
+            }
+            ASSERT_EQ(std::vector<int>(count, 1), v);
+        }
+    }
+}
+
+TEST(Bcast_Impl_MPI, Aggregator_Mixed_Types) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int root = size - 1;
+    int value = 0;
+    std::vector<double> v(7, 0.);
+    char c = 0;
+    {
+        BcastAggregator aggregator(root);
+        if (rank == root) {
+            value = 42;
+            v = { 0., 1., 2., 3., 4., 5., 6. };
+            c = 'x';
+        }
+        aggregator.enqueue(&value, 1, MPI_INT);
+        aggregator.enqueue(v.data(), 7, MPI_DOUBLE);
+        aggregator.enqueue(nullptr, 0, MPI_INT);
+        ASSERT_EQ(static_cast<int>(sizeof(int) + 7 * sizeof(double)), aggregator.pendingBytes());
+        aggregator.flush();
+        ASSERT_EQ(0, aggregator.pendingBytes());
+        ASSERT_EQ(42, value);
+        ASSERT_EQ(std::vector<double>({ 0., 1., 2., 3., 4., 5., 6. }), v);
+        // Flushed by the destructor
+        aggregator.enqueue(&c, 1, MPI_CHAR);
+    }
+    ASSERT_EQ('x', c);
+}
+
+TEST(Bcast_Impl_MPI, Aggregator_Threshold_Flush) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    std::vector<int> v(10, rank == 0 ? 5 : 0);
+    BcastAggregator aggregator(0, MPI_COMM_WORLD, 4 * sizeof(int));
+    for (int i = 0; i < 10; i++)
+        aggregator.enqueue(v.data() + i, 1, MPI_INT);
+    // Two full batches of four values are already delivered
+    ASSERT_EQ(static_cast<int>(2 * sizeof(int)), aggregator.pendingBytes());
+    ASSERT_EQ(std::vector<int>(8, 5), std::vector<int>(v.begin(), v.begin() + 8));
+    aggregator.flush();
+    ASSERT_EQ(std::vector<int>(10, 5), v);
+}
+
+TEST(Bcast_Impl_MPI, Performance_Aggregated_Vector500) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    const int size = 500;
+    const int value = 32;
+    std::vector<int> v(size, rank == 0 ? value : 0);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t1 = MPI_Wtime();
+    for (int i = 0; i < size; i++)
+        broadcast(v.data() + i, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t2 = MPI_Wtime();
+    std::vector<int> aggregated(size, rank == 0 ? value : 0);
+    {
+        BcastAggregator aggregator;
+        for (int i = 0; i < size; i++)
+            aggregator.enqueue(aggregated.data() + i, 1, MPI_INT);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t3 = MPI_Wtime();
+    if (rank == 0)
+        std::cout << "my_bcast: " << (t2 - t1) << ", aggregated: " << (t3 - t2) << std::endl;
+    ASSERT_EQ(v, aggregated);
+}
+
+TEST(Bcast_Impl_MPI, Typed_Vector_Unknown_Size) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    for (int root : { 0, size - 1, size / 2 }) {
+        for (int count : { 0, 1, 100003 }) {
+            std::vector<double> expected(count);
+            for (int i = 0; i < count; i++)
+                expected[i] = i * 0.5;
+            // Receivers start with a wrong size
+            std::vector<double> v(rank == root ? expected : std::vector<double>(7, -1.));
+            ASSERT_EQ(MPI_SUCCESS, broadcast(&v, root, MPI_COMM_WORLD));
+            ASSERT_EQ(expected, v);
+        }
+    }
+}
+
+TEST(Bcast_Impl_MPI, Typed_Vector_Of_Structs) {
+    struct Point {
+        int x;
+        double y;
+    };
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    std::vector<Point> v;
+    if (rank == 0)
+        v = { { 1, 1.5 }, { 2, 2.5 }, { 3, 3.5 } };
+    ASSERT_EQ(MPI_SUCCESS, broadcast(&v, 0));
+    ASSERT_EQ(3u, v.size());
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(i + 1, v[i].x);
+        ASSERT_EQ(i + 1.5, v[i].y);
+    }
+}
+
+TEST(Bcast_Impl_MPI, Typed_String) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    std::string s = rank == size - 1 ? "config=value" : "";
+    ASSERT_EQ(MPI_SUCCESS, broadcast(&s, size - 1));
+    ASSERT_EQ("config=value", s);
+    std::string empty = rank == 0 ? "" : "garbage";
+    ASSERT_EQ(MPI_SUCCESS, broadcast(&empty, 0));
+    ASSERT_TRUE(empty.empty());
+    ASSERT_EQ(MPI_ERR_ARG, broadcast(static_cast<std::string*>(nullptr), 0));
+}
+
+TEST(Collectives_Impl_MPI, Reduce_Comp_with_vendor) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Datatype matrix;
+    MPI_Type_contiguous(4, MPI_INT, &matrix);
+    MPI_Type_commit(&matrix);
+    MPI_Op product;
+    MPI_Op_create(collectives_test::matrixProduct, 0, &product);
+    for (int root : { 0, size - 1, size / 2 }) {
+        for (int count : { 0, 1, 7, 100000 }) {
+            std::vector<int> values = collectives_test::rankValues(rank, 4 * count);
+            std::vector<int> expected(4 * count), result(4 * count);
+            MPI_Reduce(values.data(), expected.data(), 4 * count, MPI_INT, MPI_SUM, root, MPI_COMM_WORLD);
+            ASSERT_EQ(MPI_SUCCESS,
+                      reduce(values.data(), result.data(), 4 * count, MPI_INT, MPI_SUM, root, MPI_COMM_WORLD));
+            if (rank == root) {
+                ASSERT_EQ(expected, result);
+            }
+            MPI_Reduce(values.data(), expected.data(), count, matrix, product, root, MPI_COMM_WORLD);
+            reduce(values.data(), result.data(), count, matrix, product, root, MPI_COMM_WORLD);
+            if (rank == root) {
+                ASSERT_EQ(expected, result);
+            }
+        }
+    }
+    MPI_Op_free(&product);
+    MPI_Type_free(&matrix);
+}
+
+TEST(Collectives_Impl_MPI, Allreduce_Comp_with_vendor) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    MPI_Datatype matrix;
+    MPI_Type_contiguous(4, MPI_INT, &matrix);
+    MPI_Type_commit(&matrix);
+    MPI_Op product;
+    MPI_Op_create(collectives_test::matrixProduct, 0, &product);
+    // The last counts take the ring algorithm
+    for (int count : { 0, 1, 5, 20000, 100003 }) {
+        std::vector<int> values = collectives_test::rankValues(rank, count);
+        std::vector<int> expected(count), result(count);
+        MPI_Allreduce(values.data(), expected.data(), count, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+        ASSERT_EQ(MPI_SUCCESS, allreduce(values.data(), result.data(), count, MPI_INT, MPI_MAX, MPI_COMM_WORLD));
+        ASSERT_EQ(expected, result);
+        MPI_Allreduce(values.data(), expected.data(), count, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        result = values;
+        allreduce(MPI_IN_PLACE, result.data(), count, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+        ASSERT_EQ(expected, result);
+        MPI_Allreduce(values.data(), expected.data(), count / 4, matrix, product, MPI_COMM_WORLD);
+        allreduce(values.data(), result.data(), count / 4, matrix, product, MPI_COMM_WORLD);
+        ASSERT_EQ(std::vector<int>(expected.begin(), expected.begin() + count / 4 * 4),
+                  std::vector<int>(result.begin(), result.begin() + count / 4 * 4));
+    }
+    MPI_Op_free(&product);
+    MPI_Type_free(&matrix);
+}
+
+TEST(Collectives_Impl_MPI, Gather_Scatter_Comp_with_vendor) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    for (int root : { 0, size - 1, size / 2 }) {
+        for (int count : { 0, 1, 3, 1000 }) {
+            std::vector<int> values = collectives_test::rankValues(rank, count);
+            std::vector<int> expected(count * size), result(count * size);
+            MPI_Gather(values.data(), count, MPI_INT, expected.data(), count, MPI_INT, root, MPI_COMM_WORLD);
+            ASSERT_EQ(MPI_SUCCESS, gather(values.data(), count, MPI_INT, result.data(), count, MPI_INT, root,
+                                          MPI_COMM_WORLD));
+            if (rank == root) {
+                ASSERT_EQ(expected, result);
+            }
+
+            // In place on the root: its block is already in the receive buffer
+            std::vector<int> in_place(count * size);
+            if (rank == root)
+                std::copy(values.begin(), values.end(), in_place.begin() + rank * count);
+            gather(rank == root ? MPI_IN_PLACE : values.data(), count, MPI_INT, in_place.data(), count, MPI_INT,
+                   root, MPI_COMM_WORLD);
+            if (rank == root) {
+                ASSERT_EQ(expected, in_place);
+            }
+
+            // The gathered blocks are scattered back
+            std::vector<int> block(count);
+            ASSERT_EQ(MPI_SUCCESS, scatter(expected.data(), count, MPI_INT, block.data(), count, MPI_INT, root,
+                                           MPI_COMM_WORLD));
+            ASSERT_EQ(values, block);
+        }
+    }
+}
+
+TEST(Collectives_Impl_MPI, Performance_Collectives_vs_Vendor) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int iterations = 10;
+    for (int count : { 16, 1 << 18 }) {
+        std::vector<double> values(count, rank + 1.), result(count), gathered(static_cast<size_t>(count) * size);
+        double times[8];
+        for (int variant = 0; variant < 8; variant++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            double t1 = MPI_Wtime();
+            for (int i = 0; i < iterations; i++) {
+                switch (variant) {
+                case 0:
+                    reduce(values.data(), result.data(), count, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+                    break;
+                case 1:
+                    MPI_Reduce(values.data(), result.data(), count, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+                    break;
+                case 2:
+                    allreduce(values.data(), result.data(), count, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+                    break;
+                case 3:
+                    MPI_Allreduce(values.data(), result.data(), count, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+                    break;
+                case 4:
+                    gather(values.data(), count, MPI_DOUBLE, gathered.data(), count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+                    break;
+                case 5:
+                    MPI_Gather(values.data(), count, MPI_DOUBLE, gathered.data(), count, MPI_DOUBLE, 0,
+                               MPI_COMM_WORLD);
+                    break;
+                case 6:
+                    scatter(gathered.data(), count, MPI_DOUBLE, result.data(), count, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+                    break;
+                default:
+                    MPI_Scatter(gathered.data(), count, MPI_DOUBLE, result.data(), count, MPI_DOUBLE, 0,
+                                MPI_COMM_WORLD);
+                }
+            }
+            MPI_Barrier(MPI_COMM_WORLD);
+            times[variant] = (MPI_Wtime() - t1) / iterations;
+        }
+        if (rank == 0) {
+            std::cout << "procs=" << size << " bytes=" << count * sizeof(double) << ": reduce=" << times[0]
+                      << " (MPI " << times[1] << "), allreduce=" << times[2] << " (MPI " << times[3]
+                      << "), gather=" << times[4] << " (MPI " << times[5] << "), scatter=" << times[6] << " (MPI "
+                      << times[7] << ")" << std::endl;
+        }
     }
 }
 
 int main(int argc, char *argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
-    MPI_Init(&argc, &argv);
+    // The progress thread of ibroadcast needs MPI_THREAD_MULTIPLE
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
 
     ::testing::AddGlobalTestEnvironment(new GTestMPIListener::MPIEnvironment);
     ::testing::TestEventListeners &listeners = ::testing::UnitTest::GetInstance()->listeners();
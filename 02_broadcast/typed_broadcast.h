@@ -0,0 +1,51 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <string>
+#include <vector>
+#include "bcast_tree.h"
+#include "mpi_datatype.h"
+
+namespace TypedBroadcastDetail {
+    // Broadcast along the binary heap of broadcast() to receivers which do not know the size.
+    // A receiver probes the message from its parent (MPI_Mprobe), so the size comes with the data
+    // in a single message, resizes the container once and forwards it to the children.
+    template <typename Container>
+    int broadcastResizable(Container* container, MPI_Datatype datatype, int root, MPI_Comm comm) {
+        if (container == nullptr)
+            return MPI_ERR_ARG;
+        int rank, size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+        if (rank != root) {
+            MPI_Message message;
+            MPI_Status status;
+            MPI_Mprobe(heap_parent(rank, root, 2), 0, comm, &message, &status);
+            int count;
+            MPI_Get_count(&status, datatype, &count);
+            container->resize(count);
+            MPI_Mrecv(count > 0 ? &(*container)[0] : nullptr, count, datatype, &message, MPI_STATUS_IGNORE);
+        }
+        int count = static_cast<int>(container->size());
+        void* buffer = count > 0 ? &(*container)[0] : nullptr;
+        std::vector<int> children = heap_children(rank, root, size, 2);
+        std::vector<MPI_Request> requests(children.size());
+        for (size_t i = 0; i < children.size(); i++)
+            MPI_Isend(buffer, count, datatype, children[i], 0, comm, &requests[i]);
+        if (!requests.empty())
+            MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+        return MPI_SUCCESS;
+    }
+}  // namespace TypedBroadcastDetail
+
+// Broadcasts the vector of the root, the vectors of the other processes are resized to its size
+template <typename T>
+int broadcast(std::vector<T>* vector, int root, MPI_Comm comm = MPI_COMM_WORLD) {
+    return TypedBroadcastDetail::broadcastResizable(vector, MpiDatatype<T>::get(), root, comm);
+}
+
+// Broadcasts the string of the root, the strings of the other processes are resized to its size
+inline int broadcast(std::string* string, int root, MPI_Comm comm = MPI_COMM_WORLD) {
+    return TypedBroadcastDetail::broadcastResizable(string, MPI_CHAR, root, comm);
+}
@@ -0,0 +1,65 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+#include <mpi.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "sample_sort.h"
+
+namespace KeyIndexSort {
+    // Key of a record with the record's index in the array
+    template <typename K>
+    struct KeyIndex {
+        K key;
+        int64_t index;
+    };
+
+    template <typename T, typename KeyOf>
+    using KeyType = typename std::decay<typename std::result_of<KeyOf(const T&)>::type>::type;
+}  // namespace KeyIndexSort
+
+/**
+ * Sorts records by the keys extracted with key_of, the result is on the process 0
+ *
+ * Only (key, index) pairs go through the parallel sort, the records stay on the
+ * process 0 and are permuted once at the end, so large records do not travel
+ * through the network at all:
+ *     parallelSortByKey(records, [](const Record& record) { return record.id; })
+ *
+ * The keys are compared with comp, records with equal keys keep their order.
+ */
+template <typename T, typename KeyOf, typename Compare = std::less<KeyIndexSort::KeyType<T, KeyOf>>>
+std::vector<T> parallelSortByKey(std::vector<T> arr, KeyOf key_of, MPI_Comm comm = MPI_COMM_WORLD,
+                                 Compare comp = Compare()) {
+    using KeyIndex = KeyIndexSort::KeyIndex<KeyIndexSort::KeyType<T, KeyOf>>;
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+
+    std::vector<KeyIndex> keys(arr.size());
+    if (rank == 0)
+        for (size_t i = 0; i < arr.size(); i++)
+            keys[i] = KeyIndex{ key_of(arr[i]), static_cast<int64_t>(i) };
+    auto key_less = [comp](const KeyIndex& first, const KeyIndex& second) {
+        if (comp(first.key, second.key))
+            return true;
+        if (comp(second.key, first.key))
+            return false;
+        return first.index < second.index;
+    };
+    auto sort_func = [key_less](std::vector<KeyIndex> part) {
+        std::sort(part.begin(), part.end(), key_less);
+        return part;
+    };
+    keys = parallelSort(std::move(keys), sort_func, comm, key_less);
+    if (rank != 0)
+        return arr;
+
+    std::vector<T> result;
+    result.reserve(arr.size());
+    for (const auto& key : keys)
+        result.push_back(std::move(arr[key.index]));
+    return result;
+}
@@ -2,9 +2,45 @@
 #include <mpi.h>
 #include <gtest-mpi-listener.hpp>
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <iostream>
+#include <limits>
+#include <random>
 #include <vector>
+#include "sample_sort.h"
+#include "key_index_sort.h"
 #include "shell_sort_batcher_merge.h"
+#include "sort_kernels.h"
+
+namespace sort_inputs {
+    // Uniform over the whole range of int
+    Vector uniform(int size, uint32_t seed) {
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<int> dist(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+        Vector result(size);
+        for (auto& value : result)
+            value = dist(gen);
+        return result;
+    }
+
+    // Most of the values are small
+    Vector skewed(int size, uint32_t seed) {
+        std::mt19937 gen(seed);
+        std::exponential_distribution<double> dist(1.);
+        Vector result(size);
+        for (auto& value : result)
+            value = static_cast<int>(std::min(dist(gen) * 1000., 1e9));
+        return result;
+    }
+
+    Vector duplicates(int size, uint32_t seed) {
+        std::mt19937 gen(seed);
+        Vector result(size);
+        for (auto& value : result)
+            value = static_cast<int>(gen() % 4);
+        return result;
+    }
+}  // namespace sort_inputs
 
 TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Size_10) {
     int rank;
@@ -72,6 +108,472 @@ TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Size_1000) {
     }
 }
 
+TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Random_Vector_Is_Reproducible) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int arr_size = 1000;
+    const uint64_t seed = 2020;
+    int part_size = arr_size / size;
+    Vector part = createRandomVectorPart(seed, static_cast<int64_t>(rank) * part_size, part_size);
+    Vector arr(rank == 0 ? part_size * size : 0);
+    MPI_Gather(part.data(), part_size, MPI_INT, arr.data(), part_size, MPI_INT, 0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        Vector exp_arr = createRandomVector(arr_size, seed);
+        exp_arr.resize(part_size * size);
+        ASSERT_EQ(exp_arr, arr);
+    }
+}
+
+TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Repeated_Sorts) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    for (int i = 0; i < 5; i++) {
+        std::vector<int> arr(300);
+        if (rank == 0)
+            arr = createRandomVector(300, i);
+        auto check_arr = BatcherMerge::parallelSort(arr, shellSort);
+        if (rank == 0) {
+            auto exp_arr = shellSort(arr);
+            ASSERT_EQ(exp_arr, check_arr);
+        }
+    }
+}
+
+TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Schedule_Is_Cached_Per_Communicator) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const BatcherMerge::Schedule& schedule = BatcherMerge::Schedule::get(MPI_COMM_WORLD);
+    ASSERT_EQ(&schedule, &BatcherMerge::Schedule::get(MPI_COMM_WORLD));
+
+    // Every comparator of the network appears in the schedules of both its processes
+    int steps_count = static_cast<int>(schedule.steps().size()), total_steps;
+    MPI_Allreduce(&steps_count, &total_steps, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    ASSERT_EQ(2 * BatcherMerge::buildNetwork(size).size(), static_cast<size_t>(total_steps));
+    for (const auto& step : schedule.steps())
+        ASSERT_NE(rank, step.partner);
+
+    // A communicator of another size has its own schedule
+    MPI_Comm half;
+    MPI_Comm_split(MPI_COMM_WORLD, rank % 2, rank, &half);
+    int half_size;
+    MPI_Comm_size(half, &half_size);
+    std::vector<int> arr(100);
+    if (rank < 2)
+        arr = createRandomVector(100, 7);
+    auto check_arr = BatcherMerge::parallelSort(arr, shellSort, half);
+    if (rank < 2) {
+        ASSERT_EQ(shellSort(arr), check_arr);
+    }
+    ASSERT_LE(BatcherMerge::Schedule::get(half).steps().size(), BatcherMerge::buildNetwork(half_size).size());
+    MPI_Comm_free(&half);
+}
+
+TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Uneven_Sizes) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    for (int arr_size : { 2, 3, 7, 17, 129, 257, 1025 }) {
+        std::vector<int> arr(arr_size);
+        if (rank == 0)
+            arr = createRandomVector(arr_size, arr_size);
+        auto check_arr = BatcherMerge::parallelSort(arr, shellSort);
+        if (rank == 0) {
+            ASSERT_EQ(shellSort(arr), check_arr);
+        }
+    }
+}
+
+TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Size_33_With_Max_Values) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    std::vector<int> arr(33);
+    if (rank == 0) {
+        arr = createRandomVector(33, 33);
+        arr[0] = arr[10] = std::numeric_limits<int>::max();
+        arr[5] = std::numeric_limits<int>::min();
+    }
+    auto check_arr = BatcherMerge::parallelSort(arr, shellSort);
+    if (rank == 0) {
+        ASSERT_EQ(shellSort(arr), check_arr);
+    }
+}
+
+TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Performance_Sizes_Above_Powers_Of_Two) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    for (int power = 14; power <= 18; power += 2) {
+        for (int arr_size : { 1 << power, (1 << power) + 1 }) {
+            std::vector<int> arr(arr_size);
+            if (rank == 0)
+                arr = createRandomVector(arr_size, power);
+            MPI_Barrier(MPI_COMM_WORLD);
+            double t1 = MPI_Wtime();
+            auto check_arr = BatcherMerge::parallelSort(arr, shellSort);
+            double t2 = MPI_Wtime();
+            if (rank == 0) {
+                std::cout << "procs=" << size << " size=" << arr_size << ": time=" << (t2 - t1)
+                          << ", block=" << (arr_size + size - 1) / size << std::endl;
+                std::sort(arr.begin(), arr.end());
+                ASSERT_EQ(arr, check_arr);
+            }
+        }
+    }
+}
+
+TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Sorted_Input_Skips_Exchanges) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    std::vector<int> arr(1000);
+    for (int i = 0; i < 1000; i++)
+        arr[i] = i / 3;
+    BatcherMerge::ExchangeStats stats;
+    auto check_arr = BatcherMerge::parallelSort(arr, shellSort, MPI_COMM_WORLD, &stats);
+    if (rank == 0) {
+        ASSERT_EQ(arr, check_arr);
+    }
+    ASSERT_EQ(stats.stages, stats.skipped);
+    ASSERT_EQ(0, stats.moved_elements);
+}
+
+TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Reversed_Input) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    std::vector<int> arr(1001);
+    for (int i = 0; i < 1001; i++)
+        arr[i] = 1001 - i;
+    auto check_arr = BatcherMerge::parallelSort(arr, shellSort);
+    if (rank == 0) {
+        std::sort(arr.begin(), arr.end());
+        ASSERT_EQ(arr, check_arr);
+    }
+}
+
+TEST(Parallel_Shell_Sort_Batcher_Merge_MPI, Performance_Nearly_Sorted_Exchanges) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int arr_size = 1 << 18;
+    std::vector<int> arr(arr_size);
+    // Sorted except for a few local swaps
+    for (int i = 0; i < arr_size; i++)
+        arr[i] = i;
+    for (int i = 0; i + 1 < arr_size; i += 4096)
+        std::swap(arr[i], arr[i + 1]);
+    for (auto input : { arr, createRandomVector(arr_size, 22) }) {
+        BatcherMerge::ExchangeStats stats;
+        MPI_Barrier(MPI_COMM_WORLD);
+        double t1 = MPI_Wtime();
+        auto check_arr = BatcherMerge::parallelSort(input, shellSort, MPI_COMM_WORLD, &stats);
+        double t2 = MPI_Wtime();
+        int64_t local[3] = { stats.stages, stats.skipped, stats.moved_elements }, total[3];
+        MPI_Reduce(local, total, 3, MPI_INT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+        if (rank == 0) {
+            std::cout << "procs=" << size << ": time=" << (t2 - t1) << ", exchanges=" << total[0] / 2
+                      << ", skipped=" << total[1] / 2 << ", moved_elements=" << total[2] << std::endl;
+            std::sort(input.begin(), input.end());
+            ASSERT_EQ(input, check_arr);
+        }
+    }
+}
+
+TEST(Parallel_Sample_Sort_MPI, All_Inputs) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    for (int arr_size : { 2, 9, 100, 1001, 20000 }) {
+        for (auto generate : { sort_inputs::uniform, sort_inputs::skewed, sort_inputs::duplicates }) {
+            Vector arr = generate(arr_size, arr_size);
+            auto check_arr = SampleSort::parallelSort(arr, shellSort);
+            if (rank == 0) {
+                std::sort(arr.begin(), arr.end());
+                ASSERT_EQ(arr, check_arr);
+            }
+        }
+    }
+}
+
+TEST(Parallel_Sample_Sort_MPI, All_Equal_Buckets_Are_Balanced) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int arr_size = 5000;
+    for (Vector arr : { Vector(arr_size, 42), sort_inputs::duplicates(arr_size, 3) }) {
+        SampleSort::BucketStats stats;
+        auto check_arr = SampleSort::parallelSort(arr, shellSort, MPI_COMM_WORLD, &stats);
+        int64_t max_bucket_size;
+        MPI_Allreduce(&stats.bucket_size, &max_bucket_size, 1, MPI_INT64_T, MPI_MAX, MPI_COMM_WORLD);
+        // Regular sampling bounds every bucket by 2 * n / size, up to rounding of the blocks
+        ASSERT_LE(max_bucket_size, 2 * arr_size / size + size);
+        if (rank == 0) {
+            std::sort(arr.begin(), arr.end());
+            ASSERT_EQ(arr, check_arr);
+        }
+    }
+}
+
+TEST(Parallel_Sample_Sort_MPI, Selector) {
+    ASSERT_EQ(SortEngine::Batcher, chooseSortEngine(1 << 20, 2));
+    ASSERT_EQ(SortEngine::Batcher, chooseSortEngine(100, 8));
+    ASSERT_EQ(SortEngine::Sample, chooseSortEngine(1 << 20, 8));
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    Vector arr = sort_inputs::skewed(10000, 1);
+    auto check_arr = parallelSort(arr, shellSort);
+    if (rank == 0) {
+        std::sort(arr.begin(), arr.end());
+        ASSERT_EQ(arr, check_arr);
+    }
+}
+
+TEST(Parallel_Sample_Sort_MPI, Performance_Batcher_vs_Sample) {
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const char* names[] = { "uniform", "skewed", "duplicates" };
+    Vector (*generators[])(int, uint32_t) = { sort_inputs::uniform, sort_inputs::skewed, sort_inputs::duplicates };
+    auto local_sort = [](Vector part) {
+        std::sort(part.begin(), part.end());
+        return part;
+    };
+    for (int arr_size : { 1 << 16, 1 << 20 }) {
+        for (int input = 0; input < 3; input++) {
+            Vector arr = generators[input](arr_size, input);
+            MPI_Barrier(MPI_COMM_WORLD);
+            double t1 = MPI_Wtime();
+            auto batcher = BatcherMerge::parallelSort(arr, local_sort);
+            MPI_Barrier(MPI_COMM_WORLD);
+            double t2 = MPI_Wtime();
+            auto sample = SampleSort::parallelSort(arr, local_sort);
+            MPI_Barrier(MPI_COMM_WORLD);
+            double t3 = MPI_Wtime();
+            if (rank == 0) {
+                std::cout << "procs=" << size << " size=" << arr_size << " " << names[input]
+                          << ": batcher=" << (t2 - t1) << ", sample=" << (t3 - t2) << ", chosen="
+                          << (chooseSortEngine(arr_size, size) == SortEngine::Sample ? "sample" : "batcher")
+                          << std::endl;
+                ASSERT_EQ(batcher, sample);
+            }
+        }
+    }
+}
+
+TEST(Sort_Kernels, All_Kernels_Sort) {
+    const SortKernels::Kernel kernels[] = { SortKernels::Kernel::Shell, SortKernels::Kernel::Radix,
+                                            SortKernels::Kernel::Network, SortKernels::Kernel::Std };
+    for (int arr_size : { 0, 1, 7, 63, 64, 65, 1000, 4099 }) {
+        for (auto generate : { sort_inputs::uniform, sort_inputs::skewed, sort_inputs::duplicates }) {
+            Vector arr = generate(arr_size, arr_size);
+            if (arr_size > 2) {
+                arr[0] = std::numeric_limits<int>::max();
+                arr[1] = std::numeric_limits<int>::min();
+                arr[2] = -1;
+            }
+            Vector expected = arr;
+            std::sort(expected.begin(), expected.end());
+            for (auto kernel : kernels)
+                ASSERT_EQ(expected, SortKernels::kernel(kernel)(arr)) << SortKernels::kernelName(kernel);
+        }
+    }
+}
+
+TEST(Sort_Kernels, Network_Same_Result_For_Every_Isa) {
+    Vector arr = sort_inputs::uniform(10007, 5);
+    Vector expected = arr;
+    std::sort(expected.begin(), expected.end());
+    for (auto isa : { SortKernels::Isa::Scalar, SortKernels::Isa::AVX2 }) {
+        if (static_cast<int>(isa) > static_cast<int>(SortKernels::detectIsa()))
+            ASSERT_ANY_THROW(SortKernels::networkSortIsa(arr, isa));
+        else
+            ASSERT_EQ(expected, SortKernels::networkSortIsa(arr, isa));
+    }
+}
+
+TEST(Sort_Kernels, Parallel_Sort_With_Every_Kernel) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    Vector arr = sort_inputs::uniform(3001, 7);
+    auto check_radix = BatcherMerge::parallelSort(arr, SortKernels::radixSort);
+    auto check_network = SampleSort::parallelSort(arr, SortKernels::networkSort);
+    if (rank == 0) {
+        std::sort(arr.begin(), arr.end());
+        ASSERT_EQ(arr, check_radix);
+        ASSERT_EQ(arr, check_network);
+    }
+}
+
+TEST(Sort_Kernels, Performance_Ranking_By_Block_Size) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank != 0)
+        return;
+    const SortKernels::Kernel kernels[] = { SortKernels::Kernel::Shell, SortKernels::Kernel::Radix,
+                                            SortKernels::Kernel::Network, SortKernels::Kernel::Std };
+    for (int block_size : { 16, 256, 4096, 1 << 16, 1 << 20 }) {
+        // About 2^22 elements are sorted for every block size
+        int repeats = std::max(1, (1 << 22) / block_size);
+        std::vector<Vector> blocks(std::min(repeats, 64));
+        for (size_t i = 0; i < blocks.size(); i++)
+            blocks[i] = sort_inputs::uniform(block_size, static_cast<uint32_t>(i));
+        std::vector<std::pair<double, SortKernels::Kernel>> times;
+        for (auto kernel : kernels) {
+            auto sort_func = SortKernels::kernel(kernel);
+            double start = MPI_Wtime();
+            for (int i = 0; i < repeats; i++)
+                ASSERT_EQ(block_size, static_cast<int>(sort_func(blocks[i % blocks.size()]).size()));
+            times.emplace_back((MPI_Wtime() - start) / repeats, kernel);
+        }
+        std::sort(times.begin(), times.end());
+        std::cout << "block=" << block_size << ":";
+        for (const auto& time : times)
+            std::cout << " " << SortKernels::kernelName(time.second) << "=" << time.first;
+        std::cout << std::endl;
+    }
+}
+
+namespace typed_sort_test {
+    // A 64-bit key with a payload which is derived from it, so a torn record is detected
+    template <int PayloadSize>
+    struct Record {
+        int64_t key;
+        int64_t id;
+        int payload[PayloadSize];
+    };
+
+    template <int PayloadSize>
+    std::vector<Record<PayloadSize>> records(int size, int64_t keys_range) {
+        std::mt19937_64 gen(static_cast<uint64_t>(size));
+        std::vector<Record<PayloadSize>> result(size);
+        for (int i = 0; i < size; i++) {
+            result[i].key = static_cast<int64_t>(gen() % static_cast<uint64_t>(keys_range)) - keys_range / 2;
+            result[i].id = i;
+            for (int j = 0; j < PayloadSize; j++)
+                result[i].payload[j] = static_cast<int>(result[i].key * 31 + i + j);
+        }
+        return result;
+    }
+
+    template <int PayloadSize>
+    bool intact(const Record<PayloadSize>& record) {
+        for (int j = 0; j < PayloadSize; j++)
+            if (record.payload[j] != static_cast<int>(record.key * 31 + record.id + j))
+                return false;
+        return true;
+    }
+
+    struct ByKey {
+        template <typename R>
+        bool operator()(const R& first, const R& second) const {
+            return first.key < second.key;
+        }
+    };
+
+    template <typename T, typename Compare>
+    std::vector<T> localSort(std::vector<T> part) {
+        std::sort(part.begin(), part.end(), Compare());
+        return part;
+    }
+}  // namespace typed_sort_test
+
+TEST(Typed_Sort_MPI, Doubles_Descending) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    for (int arr_size : { 5, 1000, 20001 }) {
+        std::mt19937 gen(arr_size);
+        std::normal_distribution<double> dist(0., 1e6);
+        std::vector<double> arr(arr_size);
+        for (auto& value : arr)
+            value = dist(gen);
+        auto sort_func = typed_sort_test::localSort<double, std::greater<double>>;
+        auto batcher = BatcherMerge::parallelSort(arr, sort_func, MPI_COMM_WORLD, nullptr, std::greater<double>());
+        auto sample = SampleSort::parallelSort(arr, sort_func, MPI_COMM_WORLD, nullptr, std::greater<double>());
+        auto chosen = parallelSort(arr, sort_func, MPI_COMM_WORLD, std::greater<double>());
+        if (rank == 0) {
+            std::sort(arr.begin(), arr.end(), std::greater<double>());
+            ASSERT_EQ(arr, batcher);
+            ASSERT_EQ(arr, sample);
+            ASSERT_EQ(arr, chosen);
+        }
+    }
+}
+
+TEST(Typed_Sort_MPI, Records_With_Key_Comparator) {
+    using Record = typed_sort_test::Record<3>;
+    using typed_sort_test::ByKey;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    for (int arr_size : { 7, 1001, 10000 }) {
+        // Few distinct keys, so most of the records are equivalent but distinguishable
+        auto arr = typed_sort_test::records<3>(arr_size, 16);
+        auto sort_func = typed_sort_test::localSort<Record, ByKey>;
+        auto batcher = BatcherMerge::parallelSort(arr, sort_func, MPI_COMM_WORLD, nullptr, ByKey());
+        auto sample = SampleSort::parallelSort(arr, sort_func, MPI_COMM_WORLD, nullptr, ByKey());
+        if (rank == 0) {
+            for (const auto* sorted : { &batcher, &sample }) {
+                ASSERT_EQ(arr.size(), sorted->size());
+                ASSERT_TRUE(std::is_sorted(sorted->begin(), sorted->end(), ByKey()));
+                std::vector<int64_t> ids;
+                for (const auto& record : *sorted) {
+                    ASSERT_TRUE(typed_sort_test::intact(record));
+                    ids.push_back(record.id);
+                }
+                std::sort(ids.begin(), ids.end());
+                for (int i = 0; i < arr_size; i++)
+                    ASSERT_EQ(i, ids[i]);
+            }
+        }
+    }
+}
+
+TEST(Typed_Sort_MPI, Key_Index_Is_Stable) {
+    using Record = typed_sort_test::Record<5>;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    for (int arr_size : { 1, 9, 1000, 30000 }) {
+        auto arr = typed_sort_test::records<5>(arr_size, 100);
+        auto key_of = [](const Record& record) { return record.key; };
+        auto ascending = parallelSortByKey(arr, key_of);
+        auto descending = parallelSortByKey(arr, key_of, MPI_COMM_WORLD, std::greater<int64_t>());
+        if (rank == 0) {
+            auto expected = arr;
+            std::stable_sort(expected.begin(), expected.end(), typed_sort_test::ByKey());
+            ASSERT_EQ(expected.size(), ascending.size());
+            for (int i = 0; i < arr_size; i++)
+                ASSERT_EQ(expected[i].id, ascending[i].id);
+            std::stable_sort(expected.begin(), expected.end(),
+                             [](const Record& first, const Record& second) { return first.key > second.key; });
+            for (int i = 0; i < arr_size; i++) {
+                ASSERT_EQ(expected[i].id, descending[i].id);
+                ASSERT_TRUE(typed_sort_test::intact(descending[i]));
+            }
+        }
+    }
+}
+
+TEST(Typed_Sort_MPI, Performance_Key_Index_vs_Records) {
+    using Record = typed_sort_test::Record<256>;
+    using typed_sort_test::ByKey;
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const int arr_size = 1 << 15;
+    auto arr = typed_sort_test::records<256>(arr_size, int64_t(1) << 40);
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t1 = MPI_Wtime();
+    auto records = parallelSort(arr, typed_sort_test::localSort<Record, ByKey>, MPI_COMM_WORLD, ByKey());
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t2 = MPI_Wtime();
+    auto keys = parallelSortByKey(arr, [](const Record& record) { return record.key; });
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t3 = MPI_Wtime();
+    if (rank == 0) {
+        std::cout << "procs=" << size << " records=" << arr_size << " of " << sizeof(Record)
+                  << " bytes: records=" << (t2 - t1) << ", key-index=" << (t3 - t2) << std::endl;
+        for (int i = 0; i < arr_size; i++)
+            ASSERT_EQ(records[i].key, keys[i].key);
+    }
+}
+
 int main(int argc, char *argv[]) {
     ::testing::InitGoogleTest(&argc, argv);
     MPI_Init(&argc, &argv);
@@ -0,0 +1,58 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <mpi.h>
+#include <type_traits>
+
+/**
+ * Compile-time mapping of C++ types to MPI datatypes:
+ *     MpiDatatype<double>::get() == MPI_DOUBLE
+ *
+ * Arithmetic types are mapped to the predefined datatypes. Any other trivially
+ * copyable type is described as a contiguous sequence of sizeof(T) bytes, the
+ * datatype is committed on first use and lives until MPI_Finalize. Such types
+ * can only be reduced with user-defined operators (MPI_Op_create).
+ */
+template <typename T>
+struct MpiDatatype {
+    static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable types can be transferred");
+
+    static MPI_Datatype get() {
+        static MPI_Datatype datatype = create();
+        return datatype;
+    }
+
+private:
+    static MPI_Datatype create() {
+        MPI_Datatype datatype;
+        MPI_Type_contiguous(static_cast<int>(sizeof(T)), MPI_BYTE, &datatype);
+        MPI_Type_commit(&datatype);
+        return datatype;
+    }
+};
+
+#define MPI_DATATYPE_MAPPING(TYPE, DATATYPE)                                                                           \
+    template <>                                                                                                        \
+    struct MpiDatatype<TYPE> {                                                                                         \
+        static MPI_Datatype get() {                                                                                    \
+            return (DATATYPE);                                                                                         \
+        }                                                                                                              \
+    }
+
+// MPI_CHAR is a character type, MPI_MIN and MPI_MAX are defined only for the integer ones
+MPI_DATATYPE_MAPPING(char, std::is_signed<char>::value ? MPI_SIGNED_CHAR : MPI_UNSIGNED_CHAR);
+MPI_DATATYPE_MAPPING(signed char, MPI_SIGNED_CHAR);
+MPI_DATATYPE_MAPPING(unsigned char, MPI_UNSIGNED_CHAR);
+MPI_DATATYPE_MAPPING(short, MPI_SHORT);
+MPI_DATATYPE_MAPPING(unsigned short, MPI_UNSIGNED_SHORT);
+MPI_DATATYPE_MAPPING(int, MPI_INT);
+MPI_DATATYPE_MAPPING(unsigned, MPI_UNSIGNED);
+MPI_DATATYPE_MAPPING(long, MPI_LONG);
+MPI_DATATYPE_MAPPING(unsigned long, MPI_UNSIGNED_LONG);
+MPI_DATATYPE_MAPPING(long long, MPI_LONG_LONG);
+MPI_DATATYPE_MAPPING(unsigned long long, MPI_UNSIGNED_LONG_LONG);
+MPI_DATATYPE_MAPPING(float, MPI_FLOAT);
+MPI_DATATYPE_MAPPING(double, MPI_DOUBLE);
+MPI_DATATYPE_MAPPING(long double, MPI_LONG_DOUBLE);
+
+#undef MPI_DATATYPE_MAPPING
@@ -0,0 +1,8 @@
+// Copyright 2020 Vlasov Maksim
+#include "sample_sort.h"
+
+SortEngine chooseSortEngine(int arr_size, int size) {
+    if (size <= 2 || arr_size / size < 4 * size)
+        return SortEngine::Batcher;
+    return SortEngine::Sample;
+}
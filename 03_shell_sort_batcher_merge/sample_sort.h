@@ -0,0 +1,185 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+#include <mpi.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "mpi_datatype.h"
+#include "shell_sort_batcher_merge.h"
+
+namespace SampleSort {
+    namespace Detail {
+        // Element with its position in the array, such keys are unique
+        template <typename T>
+        struct Key {
+            T value;
+            int64_t position;
+        };
+
+        template <typename T, typename Compare>
+        bool keyLess(const Key<T>& first, const Key<T>& second, Compare comp) {
+            if (comp(first.value, second.value))
+                return true;
+            if (comp(second.value, first.value))
+                return false;
+            return first.position < second.position;
+        }
+
+        // Merges sorted runs [displs[i], displs[i] + counts[i]) of values
+        template <typename T, typename Compare>
+        std::vector<T> mergeRuns(const std::vector<T>& values, const Vector& counts, const Vector& displs,
+                                 Compare comp) {
+            Vector positions(displs);
+            // The heap holds the runs ordered by their current elements, the earlier run goes first on ties
+            auto greater = [&](int first, int second) {
+                const T& first_value = values[positions[first]];
+                const T& second_value = values[positions[second]];
+                if (comp(second_value, first_value))
+                    return true;
+                if (comp(first_value, second_value))
+                    return false;
+                return first > second;
+            };
+            std::priority_queue<int, std::vector<int>, decltype(greater)> heap(greater);
+            for (size_t run = 0; run < counts.size(); run++)
+                if (counts[run] > 0)
+                    heap.push(static_cast<int>(run));
+            std::vector<T> result;
+            result.reserve(values.size());
+            while (!heap.empty()) {
+                int run = heap.top();
+                heap.pop();
+                result.push_back(values[positions[run]++]);
+                if (positions[run] < displs[run] + counts[run])
+                    heap.push(run);
+            }
+            return result;
+        }
+    }  // namespace Detail
+
+    // Redistribution of the calling process during one parallelSort
+    struct BucketStats {
+        // Elements which the process merged after the all-to-all, at most about 2 * n / size
+        int64_t bucket_size = 0;
+    };
+
+    /**
+     * Parallel sorting by regular sampling
+     *
+     * The root scatters the array in near-equal blocks, every process sorts its block
+     * with sort_func and takes size regular samples of it. The root sorts the
+     * samples and broadcasts size-1 splitters, then one MPI_Alltoallv sends every
+     * element to the process of its bucket, which merges the received sorted runs
+     * (k-way merge) and the buckets are gathered back to the root.
+     *
+     * Elements are compared together with their position in the array, so the
+     * buckets stay balanced even if most of the elements are equal.
+     */
+    template <typename T, typename Compare = std::less<T>>
+    std::vector<T> parallelSort(std::vector<T> arr, typename SortFunction<T>::type sort_func,
+                                MPI_Comm comm = MPI_COMM_WORLD, BucketStats* stats = nullptr,
+                                Compare comp = Compare()) {
+        using Key = Detail::Key<T>;
+        int rank, size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        int arr_size = static_cast<int>(arr.size());
+        if (arr_size < 2)
+            return arr;
+        if (arr_size <= size)
+            return sort_func(arr);
+
+        MPI_Datatype datatype = MpiDatatype<T>::get();
+        MPI_Datatype key_datatype = MpiDatatype<Key>::get();
+        auto key_less = [&comp](const Key& first, const Key& second) {
+            return Detail::keyLess(first, second, comp);
+        };
+
+        Vector counts(size), displs(size);
+        for (int i = 0, displ = 0; i < size; i++) {
+            counts[i] = arr_size / size + (i < arr_size % size ? 1 : 0);
+            displs[i] = displ;
+            displ += counts[i];
+        }
+        std::vector<T> part(counts[rank]);
+        MPI_Scatterv(arr.data(), counts.data(), displs.data(), datatype, part.data(), counts[rank], datatype, 0,
+                     comm);
+        part = sort_func(part);
+        int part_size = static_cast<int>(part.size());
+        // The sorted block is numbered from the block's displacement, so the keys stay sorted
+        auto key = [&](int i) { return Key{ part[i], static_cast<int64_t>(displs[rank]) + i }; };
+
+        std::vector<Key> samples(size);
+        for (int i = 0; i < size; i++)
+            samples[i] = key(static_cast<int>(static_cast<int64_t>(i) * part_size / size));
+        std::vector<Key> all_samples(rank == 0 ? size * size : 0);
+        MPI_Gather(samples.data(), size, key_datatype, all_samples.data(), size, key_datatype, 0, comm);
+        std::vector<Key> splitters(size - 1);
+        if (rank == 0) {
+            std::sort(all_samples.begin(), all_samples.end(), key_less);
+            for (int i = 1; i < size; i++)
+                splitters[i - 1] = all_samples[i * size + size / 2 - 1];
+        }
+        MPI_Bcast(splitters.data(), size - 1, key_datatype, 0, comm);
+
+        // Bucket i gets the keys in (splitter[i - 1], splitter[i]]
+        Vector send_counts(size), send_displs(size);
+        for (int i = 0, first = 0; i < size; i++) {
+            int last = part_size;
+            if (i + 1 < size) {
+                int low = first, high = part_size;
+                while (low < high) {
+                    int middle = low + (high - low) / 2;
+                    if (!key_less(splitters[i], key(middle)))
+                        low = middle + 1;
+                    else
+                        high = middle;
+                }
+                last = low;
+            }
+            send_displs[i] = first;
+            send_counts[i] = last - first;
+            first = last;
+        }
+        Vector recv_counts(size), recv_displs(size);
+        MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1, MPI_INT, comm);
+        for (int i = 1; i < size; i++)
+            recv_displs[i] = recv_displs[i - 1] + recv_counts[i - 1];
+        std::vector<T> bucket(recv_displs[size - 1] + recv_counts[size - 1]);
+        MPI_Alltoallv(part.data(), send_counts.data(), send_displs.data(), datatype, bucket.data(),
+                      recv_counts.data(), recv_displs.data(), datatype, comm);
+        bucket = Detail::mergeRuns(bucket, recv_counts, recv_displs, comp);
+        if (stats != nullptr)
+            stats->bucket_size = static_cast<int64_t>(bucket.size());
+
+        int bucket_size = static_cast<int>(bucket.size());
+        MPI_Gather(&bucket_size, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, comm);
+        if (rank == 0)
+            for (int i = 1; i < size; i++)
+                displs[i] = displs[i - 1] + counts[i - 1];
+        MPI_Gatherv(bucket.data(), bucket_size, datatype, arr.data(), counts.data(), displs.data(), datatype, 0,
+                    comm);
+        return arr;
+    }
+}  // namespace SampleSort
+
+enum class SortEngine { Batcher, Sample };
+
+// Batcher's network needs O(log^2 size) exchanges of whole blocks, sample sort one all-to-all
+// but it gathers size^2 samples on the root, so it is chosen for big enough blocks
+SortEngine chooseSortEngine(int arr_size, int size);
+
+// Sorts with the engine chosen by chooseSortEngine, the result is on the process 0
+template <typename T, typename Compare = std::less<T>>
+std::vector<T> parallelSort(std::vector<T> arr, typename SortFunction<T>::type sort_func,
+                            MPI_Comm comm = MPI_COMM_WORLD, Compare comp = Compare()) {
+    int size;
+    MPI_Comm_size(comm, &size);
+    if (chooseSortEngine(static_cast<int>(arr.size()), size) == SortEngine::Sample)
+        return SampleSort::parallelSort(std::move(arr), sort_func, comm, nullptr, comp);
+    return BatcherMerge::parallelSort(std::move(arr), sort_func, comm, nullptr, comp);
+}
@@ -1,41 +1,60 @@
 // Copyright 2020 Vlasov Maksim
 #include <mpi.h>
-#include <cmath>
 #include <algorithm>
+#include <cstdint>
 #include <functional>
-#include <limits>
 #include <numeric>
 #include <random>
+#include <thread>
 #include <utility>
 #include <vector>
+#include "counter_random.h"
 #include "shell_sort_batcher_merge.h"
 
 
 Vector createRandomVector(int elements_count) {
     std::random_device rd;
-    std::mt19937 generator(rd());
+    uint64_t seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+    return createRandomVector(elements_count, seed);
+}
+
+Vector createRandomVector(int elements_count, uint64_t seed) {
     Vector result(elements_count);
-    for (int& elem : result)
-        elem = static_cast<int>(generator() % 100u);
+    // Small vectors are not worth starting threads for
+    int num_threads = elements_count < (1 << 16) ? 1 : std::max(1u, std::thread::hardware_concurrency());
+    CounterRandom::fillParallel(seed, 0, elements_count, 100u, result.data(), num_threads);
+    return result;
+}
+
+Vector createRandomVectorPart(uint64_t seed, int64_t begin, int count) {
+    Vector result(count);
+    CounterRandom::fill(seed, begin, count, 100u, result.data());
     return result;
 }
 
 Vector shellSort(Vector arr) {
-    auto size = arr.size();
-    for (auto step = size / 2; step > 0; step /= 2) {
-        for (auto i = step; i < size; i++) {
-            for (auto j = i; j >= step && arr[j] < arr[j - step]; j -= step) {
-                std::swap(arr[j], arr[j - step]);
-            }
+    size_t size = arr.size();
+    // Ciura's sequence, continued with the ratio 2.25
+    std::vector<size_t> gaps = { 1, 4, 10, 23, 57, 132, 301, 701, 1750 };
+    while (gaps.back() < size / 2)
+        gaps.push_back(gaps.back() * 9 / 4);
+    for (auto gap = gaps.rbegin(); gap != gaps.rend(); ++gap) {
+        size_t step = *gap;
+        if (step >= size)
+            continue;
+        // Insertion with shifting: the element is written once at its place
+        for (size_t i = step; i < size; i++) {
+            int value = arr[i];
+            size_t j = i;
+            for (; j >= step && value < arr[j - step]; j -= step)
+                arr[j] = arr[j - step];
+            arr[j] = value;
         }
     }
     return arr;
 }
 
 namespace BatcherMerge {
-    using Comparator = std::pair<int, int>;
-    std::vector<Comparator> comparators;
-
     Vector join(const Vector& first, const Vector& second) {
         Vector temp(0);
         temp.reserve(first.size() + second.size());
@@ -44,12 +63,12 @@ namespace BatcherMerge {
         return temp;
     }
 
-    void mergeNetwork(const Vector& ranks_up, const Vector& ranks_down) {
+    void mergeNetwork(const Vector& ranks_up, const Vector& ranks_down, std::vector<Comparator>* comparators) {
         size_t size = ranks_up.size() + ranks_down.size();
         if (size == 1)
             return;
         if (size == 2) {
-            comparators.emplace_back(ranks_up.front(), ranks_down.front());
+            comparators->emplace_back(ranks_up.front(), ranks_down.front());
             return;
         }
 
@@ -68,15 +87,15 @@ namespace BatcherMerge {
                 ranks_down_even.push_back(ranks_down[i]);
         }
 
-        mergeNetwork(ranks_up_odd, ranks_down_odd);
-        mergeNetwork(ranks_up_even, ranks_down_even);
+        mergeNetwork(ranks_up_odd, ranks_down_odd, comparators);
+        mergeNetwork(ranks_up_even, ranks_down_even, comparators);
 
         Vector temp_comp = join(ranks_up, ranks_down);
         for (size_t i = 1; i < temp_comp.size() - 1; i += 2)
-            comparators.emplace_back(temp_comp[i], temp_comp[i + 1]);
+            comparators->emplace_back(temp_comp[i], temp_comp[i + 1]);
     }
 
-    void buildNetwork(const Vector& ranks) {
+    void buildNetwork(const Vector& ranks, std::vector<Comparator>* comparators) {
         size_t size = ranks.size();
         if (size < 2)
             return;
@@ -85,86 +104,47 @@ namespace BatcherMerge {
         Vector ranks_up{ ranks.begin(), ranks.begin() + ranks_up_size };
         Vector ranks_down{ ranks.begin() + ranks_up_size, ranks.end() };
 
-        buildNetwork(ranks_up);
-        buildNetwork(ranks_down);
-        mergeNetwork(ranks_up, ranks_down);
+        buildNetwork(ranks_up, comparators);
+        buildNetwork(ranks_down, comparators);
+        mergeNetwork(ranks_up, ranks_down, comparators);
     }
 
-    void check(Vector* arr) {
-        size_t i = 0;
-        for (i = arr->size() - 1; i > 0; i--)
-            if (arr->at(i - 1) > arr->at(i))
-                break;
-        while (i > 0 && arr->at(i - 1) > arr->at(i)) {
-            std::swap(arr->at(i - 1), arr->at(i));
-            i--;
-        }
+    std::vector<Comparator> buildNetwork(int size) {
+        Vector ranks(size);
+        std::iota(ranks.begin(), ranks.end(), 0);
+        std::vector<Comparator> comparators;
+        buildNetwork(ranks, &comparators);
+        return comparators;
     }
 
-    Vector parallelSort(Vector arr, std::function<Vector(Vector)> sort_func) {
-        int rank, size;
-        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-        MPI_Comm_size(MPI_COMM_WORLD, &size);
-
-        int arr_size = static_cast<int>(arr.size());
-        if (arr_size < 2)
-            return arr;
-        if (arr_size <= size)
-            return sort_func(arr);
+    Schedule::Schedule(int size, int rank) {
+        for (const auto& comp : buildNetwork(size)) {
+            if (comp.first == rank)
+                steps_.push_back({ comp.second, true });
+            else if (comp.second == rank)
+                steps_.push_back({ comp.first, false });
+        }
+    }
 
-        // int extra_size = arr_size % size;
-        int extra_size = static_cast<int>(std::pow(2, std::ceil(std::log2(arr_size + arr_size % size)))) - arr_size;
-        arr_size += extra_size;
-        arr.resize(arr_size, std::numeric_limits<int>::max());
-        int part_size = arr_size / size;
+    static int deleteSchedule(MPI_Comm, int, void* attribute, void*) {
+        delete static_cast<Schedule*>(attribute);
+        return MPI_SUCCESS;
+    }
 
-        Vector ranks(size);
-        std::iota(ranks.begin(), ranks.end(), 0);
-        buildNetwork(ranks);
-
-        Vector part(part_size), part_curr(part_size), part_temp(part_size);
-        MPI_Scatter(arr.data(), part_size, MPI_INT, part.data(), part_size, MPI_INT, 0, MPI_COMM_WORLD);
-        part = sort_func(part);
-
-        for (const auto& comp : comparators) {
-            if (rank == comp.first) {
-                MPI_Send(part.data(), part_size, MPI_INT, comp.second, 0, MPI_COMM_WORLD);
-                MPI_Recv(part_curr.data(), part_size, MPI_INT, comp.second, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                for (int i = 0, i_curr = 0, i_temp = 0; i_temp < part_size; i_temp++) {
-                    int value = part[i];
-                    int value_curr = part_curr[i_curr];
-                    if (value < value_curr) {
-                        part_temp[i_temp] = value;
-                        i++;
-                    } else {
-                        part_temp[i_temp] = value_curr;
-                        i_curr++;
-                    }
-                }
-                std::swap(part, part_temp);
-            } else if (rank == comp.second) {
-                MPI_Recv(part_curr.data(), part_size, MPI_INT, comp.first, 0, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                MPI_Send(part.data(), part_size, MPI_INT, comp.first, 0, MPI_COMM_WORLD);
-                size_t i_start = part_size - 1;
-                for (int i = i_start, i_curr = i_start, i_temp = part_size; i_temp > 0; i_temp--) {
-                    int value = part[i];
-                    int value_curr = part_curr[i_curr];
-                    if (value > value_curr) {
-                        part_temp[i_temp - 1] = value;
-                        i--;
-                    } else {
-                        part_temp[i_temp - 1] = value_curr;
-                        i_curr--;
-                    }
-                }
-                std::swap(part, part_temp);
-            }
+    const Schedule& Schedule::get(MPI_Comm comm) {
+        static int keyval = MPI_KEYVAL_INVALID;
+        if (keyval == MPI_KEYVAL_INVALID)
+            MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, deleteSchedule, &keyval, nullptr);
+        Schedule* schedule;
+        int flag;
+        MPI_Comm_get_attr(comm, keyval, &schedule, &flag);
+        if (!flag) {
+            int rank, size;
+            MPI_Comm_rank(comm, &rank);
+            MPI_Comm_size(comm, &size);
+            schedule = new Schedule(size, rank);
+            MPI_Comm_set_attr(comm, keyval, schedule);
         }
-        MPI_Gather(part.data(), part_size, MPI_INT, arr.data(), part_size, MPI_INT, 0, MPI_COMM_WORLD);
-        arr_size -= extra_size;
-        arr.resize(arr_size);
-        if (rank == 0)
-            check(&arr);
-        return arr;
+        return *schedule;
     }
 }  // namespace BatcherMerge
@@ -1,14 +1,190 @@
 // Copyright 2020 Vlasov Maksim
 #pragma once
+#include <mpi.h>
+#include <algorithm>
+#include <cstdint>
 #include <functional>
+#include <utility>
 #include <vector>
+#include "mpi_datatype.h"
 
 using Vector = std::vector<int>;
 
+// Local sort of a block, it must order the elements the same way as the comparator of the parallel sort
+template <typename T>
+struct SortFunction {
+    using type = std::function<std::vector<T>(std::vector<T>)>;
+};
+
+/**
+ * Random vectors are generated by a counter-based generator (see counter_random.h):
+ * the element with index i depends only on the seed and on i, so any part of the
+ * vector may be generated independently by any process.
+ */
 Vector createRandomVector(int size);
+Vector createRandomVector(int size, uint64_t seed);
+// Elements [begin, begin + count) of createRandomVector(..., seed)
+Vector createRandomVectorPart(uint64_t seed, int64_t begin, int count);
 
 Vector shellSort(Vector arr);
 
 namespace BatcherMerge {
-    Vector parallelSort(Vector arr, std::function<Vector(Vector)> sort_func);
+    // Pair of ranks: the first one keeps the lower half of their merged parts, the second one the upper half
+    using Comparator = std::pair<int, int>;
+
+    // Batcher's odd-even merge sort network for ranks 0..size-1, the comparators are in execution order
+    std::vector<Comparator> buildNetwork(int size);
+
+    /**
+     * Part of the network which concerns one process
+     * 
+     * The network depends only on the communicator size, so it is built once per
+     * communicator: get() caches the schedule as an attribute of the communicator,
+     * it is freed together with the communicator.
+     */
+    class Schedule {
+    public:
+        struct Step {
+            int partner;
+            // The process keeps the lower half of the merged parts
+            bool keep_low;
+        };
+
+        Schedule(int size, int rank);
+
+        const std::vector<Step>& steps() const { return steps_; }
+
+        static const Schedule& get(MPI_Comm comm);
+
+    private:
+        std::vector<Step> steps_;
+    };
+
+    // Exchanges of the calling process during one parallelSort
+    struct ExchangeStats {
+        int64_t stages = 0;
+        // Stages where the blocks were already ordered and only the boundary elements were sent
+        int64_t skipped = 0;
+        // Elements sent besides the boundary ones
+        int64_t moved_elements = 0;
+    };
+
+    namespace Detail {
+        // The last element of the low block or the first one of the high block with the number of real elements
+        // in the block; the rest of the block is padding which is greater than any element
+        template <typename T>
+        struct Boundary {
+            T value;
+            int count;
+        };
+
+        // Comparator between two sorted blocks of the same length. Only the boundaries are exchanged first; if
+        // the blocks overlap, each process sends just its elements which may belong to the partner.
+        template <typename T, typename Compare>
+        void mergeSplit(std::vector<T>* part, int* count, const Schedule::Step& step, MPI_Comm comm,
+                        std::vector<T>* recv, std::vector<T>* temp, ExchangeStats* stats, Compare comp) {
+            std::vector<T>& block = *part;
+            int part_size = static_cast<int>(block.size());
+            bool own_padding = step.keep_low ? *count < part_size : *count == 0;
+            Boundary<T> boundary{ T(), *count }, partner;
+            if (!own_padding)
+                boundary.value = step.keep_low ? block[*count - 1] : block.front();
+            MPI_Sendrecv(&boundary, 1, MpiDatatype<Boundary<T>>::get(), step.partner, 0, &partner, 1,
+                         MpiDatatype<Boundary<T>>::get(), step.partner, 0, comm, MPI_STATUS_IGNORE);
+            bool partner_padding = step.keep_low ? partner.count == 0 : partner.count < part_size;
+            if (stats != nullptr)
+                stats->stages++;
+            // The blocks are ordered if the maximum of the low one does not exceed the minimum of the high one
+            bool ordered = step.keep_low ? partner_padding || (!own_padding && !comp(partner.value, boundary.value))
+                                         : own_padding || (!partner_padding && !comp(boundary.value, partner.value));
+            if (ordered) {
+                if (stats != nullptr)
+                    stats->skipped++;
+                return;
+            }
+
+            // The low process may lose its elements above the partner's minimum, the high one its elements below
+            // the partner's maximum; the rest of the block stays in place
+            int first = 0, last = *count;
+            if (step.keep_low)
+                first = static_cast<int>(std::upper_bound(block.begin(), block.begin() + *count, partner.value, comp) -
+                                         block.begin());
+            else if (!partner_padding)
+                last = static_cast<int>(std::lower_bound(block.begin(), block.begin() + *count, partner.value, comp) -
+                                        block.begin());
+            MPI_Status status;
+            MPI_Sendrecv(block.data() + first, last - first, MpiDatatype<T>::get(), step.partner, 0, recv->data(),
+                         part_size, MpiDatatype<T>::get(), step.partner, 0, comm, &status);
+            int recv_count;
+            MPI_Get_count(&status, MpiDatatype<T>::get(), &recv_count);
+            if (stats != nullptr)
+                stats->moved_elements += last - first;
+
+            // Both processes put the low block's elements first on ties, so they split the same sequence
+            auto own_first = block.begin() + first, own_last = block.begin() + last;
+            auto recv_first = recv->begin(), recv_last = recv->begin() + recv_count;
+            auto merged_end = step.keep_low
+                                  ? std::merge(own_first, own_last, recv_first, recv_last, temp->begin(), comp)
+                                  : std::merge(recv_first, recv_last, own_first, own_last, temp->begin(), comp);
+            int merged_count = static_cast<int>(merged_end - temp->begin());
+            if (step.keep_low) {
+                // The smallest elements of the pair, the padding takes the rest of the block
+                int taken = std::min(part_size - first, merged_count);
+                std::copy(temp->begin(), temp->begin() + taken, block.begin() + first);
+                *count = first + taken;
+            } else {
+                // The largest real elements of the pair which do not fit into the low block
+                int new_count = std::max(0, partner.count + *count - part_size);
+                int taken = new_count - (*count - last);
+                std::copy(block.begin() + last, block.begin() + *count, block.begin() + taken);
+                std::copy(temp->begin() + (merged_count - taken), temp->begin() + merged_count, block.begin());
+                *count = new_count;
+            }
+        }
+    }  // namespace Detail
+
+    /**
+     * Parallel sort by Batcher's odd-even merge network, the result is on the process 0
+     *
+     * Elements of any trivially copyable type are sent as MpiDatatype<T>, sort_func
+     * sorts the local blocks and must agree with comp:
+     *     parallelSort(values, sort_by_weight, MPI_COMM_WORLD, nullptr, ByWeight())
+     */
+    template <typename T, typename Compare = std::less<T>>
+    std::vector<T> parallelSort(std::vector<T> arr, typename SortFunction<T>::type sort_func,
+                                MPI_Comm comm = MPI_COMM_WORLD, ExchangeStats* stats = nullptr,
+                                Compare comp = Compare()) {
+        int rank, size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        int arr_size = static_cast<int>(arr.size());
+        if (arr_size < 2)
+            return arr;
+        if (arr_size <= size)
+            return sort_func(arr);
+
+        // The network sorts only blocks of equal length, so every process gets ceil(n / size) elements and the
+        // last ones pad their blocks. The padding is only counted, it stays at the end and is not gathered.
+        int part_size = (arr_size + size - 1) / size;
+        Vector counts(size), displs(size);
+        for (int i = 0; i < size; i++) {
+            displs[i] = std::min(i * part_size, arr_size);
+            counts[i] = std::min(part_size, arr_size - displs[i]);
+        }
+
+        MPI_Datatype datatype = MpiDatatype<T>::get();
+        std::vector<T> part(counts[rank]);
+        MPI_Scatterv(arr.data(), counts.data(), displs.data(), datatype, part.data(), counts[rank], datatype, 0,
+                     comm);
+        part = sort_func(part);
+        int count = counts[rank];
+        part.resize(part_size);
+
+        std::vector<T> part_curr(part_size), part_temp(2 * part_size);
+        for (const auto& step : Schedule::get(comm).steps())
+            Detail::mergeSplit(&part, &count, step, comm, &part_curr, &part_temp, stats, comp);
+        MPI_Gatherv(part.data(), counts[rank], datatype, arr.data(), counts.data(), displs.data(), datatype, 0, comm);
+        return arr;
+    }
 }  // namespace BatcherMerge
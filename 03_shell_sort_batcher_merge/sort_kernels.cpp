@@ -0,0 +1,219 @@
+// Copyright 2020 Vlasov Maksim
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "sort_kernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SORT_KERNELS_X86_64
+#include <immintrin.h>
+#endif
+
+// AVX2 code is compiled either through the target attribute (runtime dispatch)
+// or when the whole translation unit is built with AVX2 enabled
+#if defined(SORT_KERNELS_X86_64) && (defined(__GNUC__) || defined(__clang__))
+#define SORT_KERNELS_AVX2
+#define SORT_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(SORT_KERNELS_X86_64) && defined(__AVX2__)
+#define SORT_KERNELS_AVX2
+#define SORT_KERNELS_TARGET_AVX2
+#endif
+
+namespace SortKernels {
+    Vector radixSort(Vector arr) {
+        size_t size = arr.size();
+        if (size < 2)
+            return arr;
+        // With the sign bit flipped the keys compare as unsigned like the values as signed
+        const uint32_t sign = 0x80000000u;
+        std::vector<uint32_t> keys(size), buffer(size);
+        std::vector<size_t> counts(4 * 256);
+        for (size_t i = 0; i < size; i++) {
+            keys[i] = static_cast<uint32_t>(arr[i]) ^ sign;
+            for (int pass = 0; pass < 4; pass++)
+                counts[pass * 256 + ((keys[i] >> (8 * pass)) & 0xFF)]++;
+        }
+        for (int pass = 0; pass < 4; pass++) {
+            size_t* count = &counts[pass * 256];
+            int shift = 8 * pass;
+            if (count[(keys[0] >> shift) & 0xFF] == size)
+                continue;
+            for (size_t digit = 0, offset = 0; digit < 256; digit++) {
+                size_t digit_count = count[digit];
+                count[digit] = offset;
+                offset += digit_count;
+            }
+            for (uint32_t key : keys)
+                buffer[count[(key >> shift) & 0xFF]++] = key;
+            keys.swap(buffer);
+        }
+        for (size_t i = 0; i < size; i++)
+            arr[i] = static_cast<int>(keys[i] ^ sign);
+        return arr;
+    }
+
+    // Optimal sorting network for 8 elements (19 comparators in 6 layers)
+    static const int NETWORK[19][2] = { { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 }, { 0, 4 }, { 1, 5 }, { 2, 6 },
+                                        { 3, 7 }, { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 }, { 2, 4 }, { 3, 5 },
+                                        { 1, 4 }, { 3, 6 }, { 1, 2 }, { 3, 4 }, { 5, 6 } };
+    static const size_t RUN_SIZE = 8;
+    static const size_t BLOCK_SIZE = RUN_SIZE * RUN_SIZE;
+
+    // The block is 8 rows of 8 elements: the network sorts the columns, then the
+    // block is transposed, so every row becomes a sorted run
+    static void sortBlockScalar(int* block) {
+        for (const auto& comparator : NETWORK) {
+            int* first = block + comparator[0] * RUN_SIZE;
+            int* second = block + comparator[1] * RUN_SIZE;
+            for (size_t column = 0; column < RUN_SIZE; column++) {
+                int low = std::min(first[column], second[column]);
+                second[column] = std::max(first[column], second[column]);
+                first[column] = low;
+            }
+        }
+        for (size_t row = 0; row < RUN_SIZE; row++)
+            for (size_t column = row + 1; column < RUN_SIZE; column++)
+                std::swap(block[row * RUN_SIZE + column], block[column * RUN_SIZE + row]);
+    }
+
+#ifdef SORT_KERNELS_AVX2
+    SORT_KERNELS_TARGET_AVX2 static void sortBlockAVX2(int* block) {
+        __m256i rows[8];
+        for (int row = 0; row < 8; row++)
+            rows[row] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + row * RUN_SIZE));
+        for (const auto& comparator : NETWORK) {
+            __m256i low = _mm256_min_epi32(rows[comparator[0]], rows[comparator[1]]);
+            rows[comparator[1]] = _mm256_max_epi32(rows[comparator[0]], rows[comparator[1]]);
+            rows[comparator[0]] = low;
+        }
+        // Transpose: pairs of 32-bit elements, then pairs of 64-bit ones, then 128-bit halves
+        __m256i pairs[8], quads[8];
+        for (int row = 0; row < 8; row += 2) {
+            pairs[row] = _mm256_unpacklo_epi32(rows[row], rows[row + 1]);
+            pairs[row + 1] = _mm256_unpackhi_epi32(rows[row], rows[row + 1]);
+        }
+        for (int row = 0; row < 8; row += 4) {
+            quads[row] = _mm256_unpacklo_epi64(pairs[row], pairs[row + 2]);
+            quads[row + 1] = _mm256_unpackhi_epi64(pairs[row], pairs[row + 2]);
+            quads[row + 2] = _mm256_unpacklo_epi64(pairs[row + 1], pairs[row + 3]);
+            quads[row + 3] = _mm256_unpackhi_epi64(pairs[row + 1], pairs[row + 3]);
+        }
+        for (int row = 0; row < 4; row++) {
+            rows[row] = _mm256_permute2x128_si256(quads[row], quads[row + 4], 0x20);
+            rows[row + 4] = _mm256_permute2x128_si256(quads[row], quads[row + 4], 0x31);
+        }
+        for (int row = 0; row < 8; row++)
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(block + row * RUN_SIZE), rows[row]);
+    }
+#endif
+
+    Isa detectIsa() {
+#if defined(SORT_KERNELS_AVX2) && (defined(__GNUC__) || defined(__clang__))
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+            return Isa::AVX2;
+        return Isa::Scalar;
+#elif defined(SORT_KERNELS_AVX2)
+        return Isa::AVX2;
+#else
+        return Isa::Scalar;
+#endif
+    }
+
+    // The comparison result selects the source instead of a branch
+    static void mergeBranchless(const int* first, const int* first_end, const int* second, const int* second_end,
+                                int* out) {
+        while (first != first_end && second != second_end) {
+            bool take_second = *second < *first;
+            *out++ = take_second ? *second : *first;
+            second += take_second;
+            first += !take_second;
+        }
+        out = std::copy(first, first_end, out);
+        std::copy(second, second_end, out);
+    }
+
+    static Vector networkSortDispatch(Vector arr, Isa isa) {
+        size_t size = arr.size();
+        size_t blocks_end = size / BLOCK_SIZE * BLOCK_SIZE;
+        for (size_t begin = 0; begin < blocks_end; begin += BLOCK_SIZE) {
+#ifdef SORT_KERNELS_AVX2
+            if (isa == Isa::AVX2) {
+                sortBlockAVX2(&arr[begin]);
+                continue;
+            }
+#endif
+            sortBlockScalar(&arr[begin]);
+        }
+        // The tail is cut into runs of the same size
+        for (size_t begin = blocks_end; begin < size; begin += RUN_SIZE) {
+            size_t end = std::min(begin + RUN_SIZE, size);
+            for (size_t i = begin + 1; i < end; i++) {
+                int value = arr[i];
+                size_t j = i;
+                for (; j > begin && value < arr[j - 1]; j--)
+                    arr[j] = arr[j - 1];
+                arr[j] = value;
+            }
+        }
+        Vector buffer(size);
+        for (size_t width = RUN_SIZE; width < size; width *= 2) {
+            for (size_t begin = 0; begin < size; begin += 2 * width) {
+                size_t middle = std::min(begin + width, size);
+                size_t end = std::min(begin + 2 * width, size);
+                mergeBranchless(arr.data() + begin, arr.data() + middle, arr.data() + middle, arr.data() + end,
+                                buffer.data() + begin);
+            }
+            arr.swap(buffer);
+        }
+        return arr;
+    }
+
+    Vector networkSortIsa(Vector arr, Isa isa) {
+        if (static_cast<int>(isa) > static_cast<int>(detectIsa()))
+            throw std::runtime_error("Instruction set is not supported");
+        return networkSortDispatch(std::move(arr), isa);
+    }
+
+    Vector networkSort(Vector arr) {
+        static const Isa isa = detectIsa();
+        return networkSortDispatch(std::move(arr), isa);
+    }
+
+    Vector stdSort(Vector arr) {
+        std::sort(arr.begin(), arr.end());
+        return arr;
+    }
+
+    const char* kernelName(Kernel kernel) {
+        switch (kernel) {
+        case Kernel::Shell:
+            return "shell";
+        case Kernel::Radix:
+            return "radix";
+        case Kernel::Network:
+            return "network";
+        case Kernel::Std:
+            return "std";
+        }
+        return "unknown";
+    }
+
+    std::function<Vector(Vector)> kernel(Kernel kernel) {
+        switch (kernel) {
+        case Kernel::Shell:
+            return shellSort;
+        case Kernel::Radix:
+            return radixSort;
+        case Kernel::Network:
+            return networkSort;
+        case Kernel::Std:
+            return stdSort;
+        }
+        throw std::runtime_error("Unknown sort kernel");
+    }
+}  // namespace SortKernels
@@ -0,0 +1,38 @@
+// Copyright 2020 Vlasov Maksim
+#pragma once
+
+#include <functional>
+#include "shell_sort_batcher_merge.h"
+
+/**
+ * Local sort kernels for the sort_func hook of the parallel sorts:
+ *     BatcherMerge::parallelSort(arr, SortKernels::radixSort)
+ *
+ * radixSort is an LSD radix sort by bytes. The sign bit is flipped, so the
+ * negative values come first, and the passes where all the elements fall into
+ * one bucket are skipped.
+ *
+ * networkSort sorts blocks of 64 elements as 8 columns of 8 with a sorting
+ * network of min/max operations (AVX2 registers when the CPU supports them,
+ * selected at runtime), transposes the block into 8 sorted runs and merges
+ * all the runs bottom-up with a branchless merge.
+ *
+ * shellSort (see shell_sort_batcher_merge.h) and std::sort complete the family.
+ */
+namespace SortKernels {
+    enum class Isa { Scalar, AVX2 };
+
+    // The best instruction set supported by the current CPU
+    Isa detectIsa();
+
+    Vector radixSort(Vector arr);
+    Vector networkSort(Vector arr);
+    // Same as above, but forces the given instruction set (it must not exceed detectIsa())
+    Vector networkSortIsa(Vector arr, Isa isa);
+    Vector stdSort(Vector arr);
+
+    enum class Kernel { Shell, Radix, Network, Std };
+
+    const char* kernelName(Kernel kernel);
+    std::function<Vector(Vector)> kernel(Kernel kernel);
+}  // namespace SortKernels